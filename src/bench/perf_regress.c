@@ -0,0 +1,370 @@
+//
+//  perf_regress.c
+//  bench
+//
+//  Created by Scott on 19/10/2026.
+//
+
+// Runs the boid systems headless at fixed sizes and seeds and compares their timings to a stored baseline.
+// perf_regress --baseline <file> [--record] [--repeats n] [--steps n] [--tolerance t]
+//
+// Timings only compare on the machine they were recorded on, so a baseline is recorded once per machine:
+//	perf_regress --baseline src/bench/baseline.json --record
+// and committed, or kept locally for a ci runner. Until then ctest reports perf_regress as skipped.
+// Record again after a change that is meant to alter the timings, or when the workloads or systems change.
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ecs.h>
+#include <engine.h>
+#include <tune.h>
+#include <cmd.h>
+#include <arena.h>
+
+#include "boid_c.h"
+#include "boid_grid.h"
+#include "boid_domain.h"
+#include "boid_schedule.h"
+#include "obstacle.h"
+
+// exit code when no baseline has been recorded yet, ctest reports it as skipped
+#define PERF_NO_BASELINE (3)
+#define PERF_MAX_RECORDS (256)
+#define PERF_MAX_REPEATS (32)
+#define PERF_MAX_SYSTEMS (16)
+#define PERF_WARMUP_STEPS (20)
+#define PERF_STEP_TIME (1.f / 120.f)
+// spread between repeats is scaled by this before it widens the tolerance
+#define PERF_NOISE_SCALE (3.0)
+// absolute slack for system timings, systems taking microseconds are mostly timer noise
+#define PERF_SLACK_MS (0.005)
+
+typedef struct perf_workload_t {
+	int boids;
+	unsigned seed;
+} perf_workload_t;
+
+typedef struct perf_record_t {
+	int boids;
+	unsigned seed;
+	char metric[64];
+	double value;
+	double noise; // median absolute deviation of the repeats relative to value
+} perf_record_t;
+
+static const perf_workload_t perf_workloads[] = {
+	{ 1000, 1 }, { 1000, 2 },
+	{ 4000, 1 }, { 4000, 2 },
+	{ 16000, 1 },
+};
+#define PERF_WORKLOAD_COUNT (sizeof(perf_workloads) / sizeof(perf_workload_t))
+
+// the parts of the engine the sim systems use, without a window
+struct SDL_Renderer* renderer = NULL;
+
+double engine_time()
+{
+	return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+uint32_t engine_mouse_state(int* x, int* y)
+{
+	if(x != NULL) *x = 0;
+	if(y != NULL) *y = 0;
+	return 0;
+}
+
+void engine_output_size(int* w, int* h)
+{
+	*w = boid_available_area.w;
+	*h = boid_available_area.h;
+}
+
+ecsEntityId* perf_entities;
+size_t perf_entity_count;
+
+static void perf_spawn(int count, unsigned seed)
+{
+	ecsEntityId entity;
+	boid_c* boid;
+
+	for(size_t i = 0; i < perf_entity_count; ++i)
+		ecsDestroyEntity(perf_entities[i]);
+	ecsRunTasks();
+
+	perf_entities = realloc(perf_entities, count * sizeof(ecsEntityId));
+	perf_entity_count = 0;
+	if(perf_entities == NULL)
+		exit(2);
+
+	srand(seed);
+	for(int i = 0; i < count; ++i)
+	{
+		if((entity = ecsCreateEntity(boid_component)) == noentity)
+			exit(2);
+		boid = ecsGetComponentPtr(entity, boid_component);
+		(*boid) = (boid_c){
+			.position = {
+				boid_available_area.x + rand() % boid_available_area.w,
+				boid_available_area.y + rand() % boid_available_area.h
+			},
+			.uid = boid_domain_make_uid(),
+			.ownership = BOID_OWNED
+		};
+		perf_entities[perf_entity_count++] = entity;
+	}
+	ecsRunTasks();
+}
+
+static int perf_compare_doubles(const void* a, const void* b)
+{
+	double l = *(const double*)a, r = *(const double*)b;
+	return l < r ? -1 : (l > r);
+}
+
+// median of samples, and the median distance from it relative to the median
+static double perf_median(double* samples, int count, double* noise)
+{
+	double deviations[PERF_MAX_REPEATS];
+
+	qsort(samples, count, sizeof(double), &perf_compare_doubles);
+	double median = samples[count / 2];
+
+	for(int i = 0; i < count; ++i)
+		deviations[i] = fabs(samples[i] - median);
+	qsort(deviations, count, sizeof(double), &perf_compare_doubles);
+	*noise = median > 0.0 ? deviations[count / 2] / median : 0.0;
+
+	return median;
+}
+
+static size_t perf_run(const perf_workload_t* workload, int repeats, int steps, perf_record_t* records)
+{
+	double rates[PERF_MAX_REPEATS], times[PERF_MAX_SYSTEMS][PERF_MAX_REPEATS];
+	double start = 0.0, noise;
+	size_t count = 0;
+
+	for(int repeat = 0; repeat < repeats; ++repeat)
+	{
+		perf_spawn(workload->boids, workload->seed);
+		for(size_t s = 0; s < boid_schedule_tuned_count; ++s)
+			times[s][repeat] = 0.0;
+
+		for(int step = 0; step < PERF_WARMUP_STEPS + steps; ++step)
+		{
+			if(step == PERF_WARMUP_STEPS)
+				start = engine_time();
+
+			ecsRunSystems(PERF_STEP_TIME);
+			cmdFlush();
+			tuneEndFrame();
+
+			if(step < PERF_WARMUP_STEPS) continue;
+			for(size_t s = 0; s < boid_schedule_tuned_count; ++s)
+				times[s][repeat] += boid_schedule_tuned[s]->lastTime * 1000.0 / steps;
+		}
+
+		rates[repeat] = (double)steps / (engine_time() - start);
+	}
+
+	records[count] = (perf_record_t){ .boids = workload->boids, .seed = workload->seed };
+	strcpy(records[count].metric, "steps_per_second");
+	records[count].value = perf_median(rates, repeats, &noise);
+	records[count++].noise = noise;
+
+	for(size_t s = 0; s < boid_schedule_tuned_count; ++s)
+	{
+		records[count] = (perf_record_t){ .boids = workload->boids, .seed = workload->seed };
+		snprintf(records[count].metric, sizeof(records[count].metric), "%s_ms", boid_schedule_tuned[s]->name);
+		records[count].value = perf_median(times[s], repeats, &noise);
+		records[count++].noise = noise;
+	}
+
+	return count;
+}
+
+static int perf_write_baseline(const char* path, double tolerance, perf_record_t* records, size_t count)
+{
+	FILE* file = fopen(path, "w");
+	if(file == NULL)
+	{
+		SDL_Log("Failed to open %s for writing", path);
+		return 2;
+	}
+
+	fprintf(file, "{\n\t\"tolerance\": %.3f,\n\t\"records\": [\n", tolerance);
+	for(size_t i = 0; i < count; ++i)
+	{
+		fprintf(file, "\t\t{ \"boids\": %d, \"seed\": %u, \"metric\": \"%s\", \"value\": %.6g, \"noise\": %.4f }%s\n",
+				records[i].boids, records[i].seed, records[i].metric, records[i].value, records[i].noise,
+				i + 1 < count ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+
+	SDL_Log("Recorded %zu baseline values to %s", count, path);
+	return 0;
+}
+
+// reads the format written by perf_write_baseline, one record per line
+static size_t perf_read_baseline(const char* path, double* tolerance, perf_record_t* records, size_t max_records)
+{
+	char line[512], *field;
+	size_t count = 0;
+	FILE* file = fopen(path, "r");
+	if(file == NULL)
+		return 0;
+
+	while(fgets(line, sizeof(line), file) != NULL && count < max_records)
+	{
+		if((field = strstr(line, "\"tolerance\":")) != NULL)
+		{
+			*tolerance = strtod(field + strlen("\"tolerance\":"), NULL);
+			continue;
+		}
+
+		perf_record_t* record = &records[count];
+		char* boids = strstr(line, "\"boids\":"), *seed = strstr(line, "\"seed\":");
+		char* metric = strstr(line, "\"metric\": \""), *value = strstr(line, "\"value\":");
+		char* noise = strstr(line, "\"noise\":");
+		if(boids == NULL || seed == NULL || metric == NULL || value == NULL || noise == NULL)
+			continue;
+
+		record->boids = atoi(boids + strlen("\"boids\":"));
+		record->seed = (unsigned)strtoul(seed + strlen("\"seed\":"), NULL, 10);
+		metric += strlen("\"metric\": \"");
+		size_t length = strcspn(metric, "\"");
+		if(length >= sizeof(record->metric)) continue;
+		memcpy(record->metric, metric, length);
+		record->metric[length] = '\0';
+		record->value = strtod(value + strlen("\"value\":"), NULL);
+		record->noise = strtod(noise + strlen("\"noise\":"), NULL);
+		++count;
+	}
+
+	fclose(file);
+	return count;
+}
+
+// counts the metrics slower than the baseline allows, and those compared at all in compared
+static int perf_compare(perf_record_t* baseline, size_t baseline_count, double tolerance,
+						perf_record_t* current, size_t current_count, size_t* compared)
+{
+	int failures = 0;
+	*compared = 0;
+
+	for(size_t i = 0; i < current_count; ++i)
+	{
+		perf_record_t* now = &current[i], *base = NULL;
+		for(size_t j = 0; j < baseline_count && base == NULL; ++j)
+		{
+			if(baseline[j].boids == now->boids && baseline[j].seed == now->seed
+			   && strcmp(baseline[j].metric, now->metric) == 0)
+				base = &baseline[j];
+		}
+		if(base == NULL || base->value <= 0.0)
+			continue;
+
+		// noisy metrics get more room, steps per second is the only one where higher is better
+		double allowed = 1.0 + tolerance + PERF_NOISE_SCALE * (base->noise + now->noise);
+		short higher_is_better = strcmp(now->metric, "steps_per_second") == 0;
+		double limit = higher_is_better ? base->value / allowed : base->value * allowed + PERF_SLACK_MS;
+		short failed = higher_is_better ? now->value < limit : now->value > limit;
+
+		printf("%-6d %-4u %-40s %12.4f %12.4f %12.4f %s\n", now->boids, now->seed, now->metric,
+			   base->value, now->value, limit, failed ? "SLOWER" : "ok");
+		failures += failed;
+		++(*compared);
+	}
+
+	return failures;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* baseline_path = NULL;
+	short record = 0;
+	int repeats = 5, steps = 200;
+	double tolerance = -1.0, baseline_tolerance = 0.25;
+	static perf_record_t current[PERF_MAX_RECORDS], baseline[PERF_MAX_RECORDS];
+	size_t current_count = 0, baseline_count;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--record") == 0) record = 1;
+		else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline_path = argv[++i];
+		else if(strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) repeats = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--steps") == 0 && i + 1 < argc) steps = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+		else baseline_path = NULL, i = argc;
+	}
+
+	if(baseline_path == NULL || repeats < 1 || repeats > PERF_MAX_REPEATS || steps < 1)
+	{
+		fprintf(stderr, "usage: %s --baseline <file> [--record] [--repeats 1-%d] [--steps n] [--tolerance t]\n",
+				argv[0], PERF_MAX_REPEATS);
+		return 2;
+	}
+
+	baseline_count = perf_read_baseline(baseline_path, &baseline_tolerance, baseline, PERF_MAX_RECORDS);
+	// a missing baseline must not pass, it is reported as skipped so it cannot be mistaken for a passing gate
+	if(!record && baseline_count == 0)
+	{
+		SDL_Log("No baseline in %s, record one on this machine with\n\t%s --baseline %s --record\nand commit it",
+				baseline_path, argv[0], baseline_path);
+		return PERF_NO_BASELINE;
+	}
+	if(tolerance < 0.0)
+		tolerance = baseline_tolerance;
+
+	SDL_Init(0);
+	ecsInit();
+	assert(boid_schedule_tuned_count <= PERF_MAX_SYSTEMS);
+
+	// fixed thread counts keep runs comparable
+	tuneEnabled = 0;
+	boid_schedule_init(ARENA_PREFAULT);
+	ecsRunTasks();
+
+	// the arena of the interactive sim with the ui window open
+	boid_available_area = (SDL_Rect){ 500, 0, 1200, 1000 };
+	obstacle_add_circle((fvec){ 1700 * 0.55f, 1000 * 0.3f }, 60.f);
+	obstacle_add_circle((fvec){ 1700 * 0.8f, 1000 * 0.6f }, 90.f);
+	obstacle_add_rect((fvec){ 1700 * 0.6f, 1000 * 0.8f }, (fvec){ 100.f, 20.f });
+
+	for(size_t i = 0; i < PERF_WORKLOAD_COUNT; ++i)
+	{
+		current_count += perf_run(&perf_workloads[i], repeats, steps, current + current_count);
+	}
+
+	int result;
+	if(record)
+	{
+		result = perf_write_baseline(baseline_path, tolerance, current, current_count);
+	}
+	else
+	{
+		printf("%-6s %-4s %-40s %12s %12s %12s\n", "boids", "seed", "metric", "baseline", "current", "limit");
+		size_t compared;
+		int failures = perf_compare(baseline, baseline_count, tolerance, current, current_count, &compared);
+		if(failures > 0)
+			SDL_Log("%d metrics regressed beyond tolerance", failures);
+		if(compared == 0)
+			SDL_Log("No metric in %s matches this workload, record it again with --record", baseline_path);
+		// a baseline that no longer matches the workloads has to be recorded again
+		result = failures > 0 || compared == 0;
+	}
+
+	free(perf_entities);
+	obstacle_terminate();
+	boid_grid_terminate();
+	ecsTerminate();
+	cmdTerminate();
+	SDL_Quit();
+
+	return result;
+}
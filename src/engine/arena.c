@@ -0,0 +1,226 @@
+//
+//  arena.c
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "arena.h"
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define ARENA_MIN_SHIFT (6)
+#define ARENA_MIN_BLOCK ((size_t)1 << ARENA_MIN_SHIFT)
+#define ARENA_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+arena_t* arenas;
+
+static size_t arenaPageSize(arena_t* arena)
+{
+	return (arena->flags & ARENA_HUGE_PAGES) ? ARENA_HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static int arenaSizeClass(size_t size)
+{
+	int sizeClass = 0;
+	while(((size_t)1 << (sizeClass + ARENA_MIN_SHIFT)) < size)
+		++sizeClass;
+	return sizeClass;
+}
+
+static void* arenaMap(arena_t* arena, size_t size)
+{
+	void* memory = MAP_FAILED;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	short huge = 0;
+
+#if defined(MAP_POPULATE)
+	if(arena->flags & ARENA_PREFAULT)
+		flags |= MAP_POPULATE;
+#endif
+
+#if defined(MAP_HUGETLB)
+	// reserved huge pages are often not configured, fall back to regular pages quietly
+	if(arena->flags & ARENA_HUGE_PAGES)
+	{
+		memory = mmap(NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		huge = memory != MAP_FAILED;
+	}
+#endif
+
+	if(memory == MAP_FAILED)
+		memory = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if(memory == MAP_FAILED)
+	{
+		SDL_Log("%s: failed to map %zu bytes", arena->name, size);
+		return NULL;
+	}
+
+#if defined(MADV_HUGEPAGE)
+	if(!huge && (arena->flags & ARENA_HUGE_PAGES))
+		madvise(memory, size, MADV_HUGEPAGE);
+#endif
+
+#if !defined(MAP_POPULATE)
+	if(arena->flags & ARENA_PREFAULT)
+	{
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		for(size_t offset = 0; offset < size; offset += page)
+			((volatile char*)memory)[offset] = 0;
+	}
+#endif
+
+	if(arena->mappingCount >= arena->mappingCapacity)
+	{
+		size_t capacity = arena->mappingCapacity > 0 ? arena->mappingCapacity * 2 : 16;
+		arena_mapping_t* mappings = realloc(arena->mappings, capacity * sizeof(arena_mapping_t));
+		if(mappings == NULL)
+		{
+			munmap(memory, size);
+			return NULL;
+		}
+		arena->mappings = mappings;
+		arena->mappingCapacity = capacity;
+	}
+	arena->mappings[arena->mappingCount++] = (arena_mapping_t){ memory, size };
+
+	arena->mappedBytes += size;
+	if(huge)
+		arena->hugeBytes += size;
+
+	return memory;
+}
+
+// hand what is left of the current chunk to the free lists so it is not wasted
+static void arenaRetireChunk(arena_t* arena)
+{
+	if(arena->chunk == NULL)
+		return;
+
+	size_t left = arena->chunkSize - arena->chunkUsed;
+	for(int sizeClass = ARENA_SIZE_CLASSES - 1; sizeClass >= 0 && left >= ARENA_MIN_BLOCK; --sizeClass)
+	{
+		size_t block = (size_t)1 << (sizeClass + ARENA_MIN_SHIFT);
+		if(block > left) continue;
+
+		void* memory = arena->chunk + arena->chunkUsed;
+		*(void**)memory = arena->freeLists[sizeClass];
+		arena->freeLists[sizeClass] = memory;
+		arena->chunkUsed += block;
+		left -= block;
+	}
+
+	arena->chunk = NULL;
+}
+
+void arenaInit(arena_t* arena, const char* name, int flags, size_t chunkSize)
+{
+	memset(arena, 0, sizeof(arena_t));
+	arena->name = name;
+	arena->flags = flags;
+
+	size_t page = arenaPageSize(arena);
+	arena->chunkSize = (chunkSize + page - 1) / page * page;
+
+	arena->next = arenas;
+	arenas = arena;
+}
+
+void arenaTerminate(arena_t* arena)
+{
+	arena_t** link = &arenas;
+	while(*link != NULL && *link != arena)
+		link = &(*link)->next;
+	if(*link != NULL)
+		*link = arena->next;
+
+	for(size_t i = 0; i < arena->mappingCount; ++i)
+		munmap(arena->mappings[i].memory, arena->mappings[i].size);
+	free(arena->mappings);
+	memset(arena, 0, sizeof(arena_t));
+}
+
+void* arenaAlloc(arena_t* arena, size_t size)
+{
+	int sizeClass = arenaSizeClass(size);
+	if(sizeClass >= ARENA_SIZE_CLASSES)
+		return NULL;
+
+	size_t block = (size_t)1 << (sizeClass + ARENA_MIN_SHIFT);
+	void* memory;
+
+	if(arena->freeLists[sizeClass] != NULL)
+	{
+		memory = arena->freeLists[sizeClass];
+		arena->freeLists[sizeClass] = *(void**)memory;
+		++arena->recycled;
+	}
+	else if(block >= arena->chunkSize)
+	{
+		// blocks the size of a chunk or more get a mapping of their own
+		size_t page = arenaPageSize(arena);
+		if((memory = arenaMap(arena, (block + page - 1) / page * page)) == NULL)
+			return NULL;
+	}
+	else
+	{
+		if(arena->chunk == NULL || arena->chunkSize - arena->chunkUsed < block)
+		{
+			arenaRetireChunk(arena);
+			if((arena->chunk = arenaMap(arena, arena->chunkSize)) == NULL)
+				return NULL;
+			arena->chunkUsed = 0;
+		}
+		memory = arena->chunk + arena->chunkUsed;
+		arena->chunkUsed += block;
+	}
+
+	++arena->allocations;
+	arena->liveBytes += block;
+	if(arena->liveBytes > arena->peakBytes)
+		arena->peakBytes = arena->liveBytes;
+
+	return memory;
+}
+
+void arenaFree(arena_t* arena, void* memory, size_t size)
+{
+	if(memory == NULL)
+		return;
+
+	int sizeClass = arenaSizeClass(size);
+	*(void**)memory = arena->freeLists[sizeClass];
+	arena->freeLists[sizeClass] = memory;
+	arena->liveBytes -= (size_t)1 << (sizeClass + ARENA_MIN_SHIFT);
+}
+
+void* arenaRealloc(arena_t* arena, void* memory, size_t oldSize, size_t newSize)
+{
+	if(memory != NULL && arenaSizeClass(oldSize) == arenaSizeClass(newSize))
+		return memory;
+
+	void* grown = arenaAlloc(arena, newSize);
+	if(grown == NULL)
+		return NULL;
+
+	if(memory != NULL)
+	{
+		memcpy(grown, memory, oldSize < newSize ? oldSize : newSize);
+		arenaFree(arena, memory, oldSize);
+	}
+
+	return grown;
+}
+
+void arenaReport(void)
+{
+	for(arena_t* arena = arenas; arena != NULL; arena = arena->next)
+	{
+		SDL_Log("%s: %.1fMiB mapped in %zu mappings (%.1fMiB huge), %.1fMiB live, %.1fMiB peak, %zu of %zu allocations recycled",
+				arena->name, arena->mappedBytes / 1048576.0, arena->mappingCount, arena->hugeBytes / 1048576.0,
+				arena->liveBytes / 1048576.0, arena->peakBytes / 1048576.0, arena->recycled, arena->allocations);
+	}
+}
@@ -0,0 +1,80 @@
+//
+//  arena.h
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef arena_h
+#define arena_h
+
+#include <stddef.h>
+
+#define ARENA_SIZE_CLASSES (40)
+
+typedef enum arena_flags_t {
+	ARENA_HUGE_PAGES = 0x1, // back chunks with huge pages, or ask for transparent huge pages where those are not reserved
+	ARENA_PREFAULT = 0x2, // fault pages in when mapping chunks rather than on first touch
+} arena_flags_t;
+
+typedef struct arena_mapping_t {
+	void* memory;
+	size_t size;
+} arena_mapping_t;
+
+// hands out power of two blocks carved from large mappings, freed blocks are kept for reuse
+typedef struct arena_t {
+	const char* name;
+	int flags;
+	size_t chunkSize;
+
+	char* chunk;
+	size_t chunkUsed;
+	void* freeLists[ARENA_SIZE_CLASSES];
+
+	arena_mapping_t* mappings;
+	size_t mappingCount, mappingCapacity;
+
+	// statistics
+	size_t mappedBytes, hugeBytes; // hugeBytes are backed by reserved huge pages
+	size_t liveBytes, peakBytes;
+	size_t allocations, recycled;
+
+	struct arena_t* next;
+} arena_t;
+
+/**
+ * \brief Initializes an arena.
+ * \param name Identifies the arena in arenaReport.
+ * \param flags A combination of arena_flags_t.
+ * \param chunkSize The size of mappings blocks are carved from, rounded up to the page size in use.
+ * \note An arena is not thread safe, only use it from one thread at a time.
+ */
+extern void arenaInit(arena_t* arena, const char* name, int flags, size_t chunkSize);
+extern void arenaTerminate(arena_t* arena);
+
+/**
+ * \brief Allocates at least size bytes aligned to 64 bytes.
+ * \returns NULL if mapping more memory failed.
+ */
+extern void* arenaAlloc(arena_t* arena, size_t size);
+
+/**
+ * \brief Returns a block to the free list of its size class.
+ * \param size The size the block was allocated or last reallocated with.
+ */
+extern void arenaFree(arena_t* arena, void* memory, size_t size);
+
+/**
+ * \brief Grows or shrinks a block, keeping its contents.
+ * \returns memory if the new size fits in the same size class.
+ * \returns NULL if allocation failed, memory is left untouched.
+ */
+extern void* arenaRealloc(arena_t* arena, void* memory, size_t oldSize, size_t newSize);
+
+/**
+ * \brief Logs the memory use of every initialized arena.
+ */
+extern void arenaReport(void);
+
+#endif /* arena_h */
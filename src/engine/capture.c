@@ -0,0 +1,227 @@
+//
+//  capture.c
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "capture.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+FILE* captureFile;
+const char* capturePath;
+short captureY4m;
+int captureWidth, captureHeight;
+
+// staging ring, the render thread fills slot captureHead and the writer empties slot captureTail
+uint32_t* captureSlots[CAPTURE_SLOTS];
+uint32_t captureHead, captureTail;
+SDL_sem* captureReady;
+SDL_Thread* captureThread;
+int captureQuit;
+
+// converted planes, only touched by the writer thread
+uint8_t* capturePlanes;
+size_t captureWritten, captureDropped;
+short captureFailed;
+
+// full range bt.601 as y4m C420jpeg expects, with 2x2 averaged chroma
+static void captureConvert(uint32_t* pixels, uint8_t* planes)
+{
+	int w = captureWidth, h = captureHeight;
+	uint8_t* luma = planes, *cb = planes + (size_t)w * h, *cr = cb + (size_t)(w / 2) * (h / 2);
+
+	for(int y = 0; y < h; ++y)
+	{
+		uint32_t* row = pixels + (size_t)y * w;
+		for(int x = 0; x < w; ++x)
+		{
+			int r = (row[x] >> 16) & 0xFF, g = (row[x] >> 8) & 0xFF, b = row[x] & 0xFF;
+			luma[(size_t)y * w + x] = (uint8_t)((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+		}
+	}
+
+	for(int y = 0; y < h / 2; ++y)
+	{
+		uint32_t* top = pixels + (size_t)y * 2 * w, *bottom = top + w;
+		for(int x = 0; x < w / 2; ++x)
+		{
+			uint32_t p[4] = { top[x * 2], top[x * 2 + 1], bottom[x * 2], bottom[x * 2 + 1] };
+			int r = 0, g = 0, b = 0;
+			for(int i = 0; i < 4; ++i)
+			{
+				r += (p[i] >> 16) & 0xFF;
+				g += (p[i] >> 8) & 0xFF;
+				b += p[i] & 0xFF;
+			}
+			// sums of four samples, so the weights carry two fewer bits of shift
+			cb[(size_t)y * (w / 2) + x] = (uint8_t)((-11059 * r - 21709 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18);
+			cr[(size_t)y * (w / 2) + x] = (uint8_t)((32768 * r - 27439 * g - 5329 * b + (128 << 18) + (1 << 17)) >> 18);
+		}
+	}
+}
+
+static void captureWrite(uint32_t* pixels)
+{
+	size_t size = (size_t)captureWidth * captureHeight, written;
+
+	if(captureY4m)
+	{
+		captureConvert(pixels, capturePlanes);
+		size += (size_t)(captureWidth / 2) * (captureHeight / 2) * 2;
+		written = fputs("FRAME\n", captureFile) >= 0 ? fwrite(capturePlanes, 1, size, captureFile) : 0;
+	}
+	else
+	{
+		size *= sizeof(uint32_t);
+		written = fwrite(pixels, 1, size, captureFile);
+	}
+
+	if(written != size)
+	{
+		SDL_Log("Failed to write frame to %s, capture stopped", capturePath);
+		captureFailed = 1;
+		return;
+	}
+	++captureWritten;
+}
+
+static int captureWriter(void* data)
+{
+	uint32_t head;
+
+	while(1)
+	{
+		// posted once per frame handed over and once more to quit
+		SDL_SemWait(captureReady);
+		head = __atomic_load_n(&captureHead, __ATOMIC_ACQUIRE);
+
+		if(captureTail == head)
+		{
+			if(__atomic_load_n(&captureQuit, __ATOMIC_ACQUIRE)) break;
+			continue;
+		}
+
+		if(!captureFailed)
+			captureWrite(captureSlots[captureTail % CAPTURE_SLOTS]);
+		__atomic_store_n(&captureTail, captureTail + 1, __ATOMIC_RELEASE);
+	}
+
+	return 0;
+}
+
+int captureOpen(const char* path, int width, int height, int fps)
+{
+	// 4:2:0 chroma covers pixels in pairs
+	captureY4m = strlen(path) > 4 && strcmp(path + strlen(path) - 4, ".y4m") == 0;
+	captureWidth = captureY4m ? width & ~1 : width;
+	captureHeight = captureY4m ? height & ~1 : height;
+	capturePath = path;
+
+	if(captureWidth <= 0 || captureHeight <= 0)
+		return 1;
+
+	if((captureFile = fopen(path, "wb")) == NULL)
+	{
+		SDL_Log("Failed to open %s for capture", path);
+		return 2;
+	}
+
+	size_t pixels = (size_t)captureWidth * captureHeight;
+	for(int i = 0; i < CAPTURE_SLOTS; ++i)
+	{
+		if((captureSlots[i] = malloc(pixels * sizeof(uint32_t))) == NULL)
+		{
+			captureClose();
+			return 3;
+		}
+	}
+
+	if(captureY4m)
+	{
+		capturePlanes = malloc(pixels + pixels / 2);
+		if(capturePlanes == NULL)
+		{
+			captureClose();
+			return 3;
+		}
+		fprintf(captureFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", captureWidth, captureHeight, fps);
+	}
+	else
+	{
+		SDL_Log("Capturing raw bgra %dx%d at %d fps to %s", captureWidth, captureHeight, fps, path);
+	}
+
+	captureHead = captureTail = 0;
+	captureQuit = 0;
+	captureWritten = captureDropped = 0;
+	captureFailed = 0;
+	captureReady = SDL_CreateSemaphore(0);
+	captureThread = captureReady != NULL ? SDL_CreateThread(&captureWriter, "capture", NULL) : NULL;
+	if(captureThread == NULL)
+	{
+		SDL_Log("Failed to start capture thread: %s", SDL_GetError());
+		captureClose();
+		return 4;
+	}
+
+	return 0;
+}
+
+void captureFrame(struct SDL_Renderer* renderer)
+{
+	int w, h;
+
+	if(captureThread == NULL) return;
+
+	// a window that shrank below the stream, or a writer that fell behind, costs the frame and nothing else
+	SDL_GetRendererOutputSize(renderer, &w, &h);
+	if(w < captureWidth || h < captureHeight
+	   || captureHead - __atomic_load_n(&captureTail, __ATOMIC_ACQUIRE) >= CAPTURE_SLOTS)
+	{
+		++captureDropped;
+		return;
+	}
+
+	SDL_Rect rect = { 0, 0, captureWidth, captureHeight };
+	if(SDL_RenderReadPixels(renderer, &rect, SDL_PIXELFORMAT_ARGB8888,
+							captureSlots[captureHead % CAPTURE_SLOTS], captureWidth * (int)sizeof(uint32_t)) != 0)
+	{
+		++captureDropped;
+		return;
+	}
+
+	__atomic_store_n(&captureHead, captureHead + 1, __ATOMIC_RELEASE);
+	SDL_SemPost(captureReady);
+}
+
+void captureClose(void)
+{
+	if(captureThread != NULL)
+	{
+		__atomic_store_n(&captureQuit, 1, __ATOMIC_RELEASE);
+		SDL_SemPost(captureReady);
+		SDL_WaitThread(captureThread, NULL);
+		captureThread = NULL;
+		SDL_Log("Captured %zu frames to %s, dropped %zu", captureWritten, capturePath, captureDropped);
+	}
+
+	if(captureReady != NULL)
+		SDL_DestroySemaphore(captureReady);
+	captureReady = NULL;
+
+	if(captureFile != NULL)
+		fclose(captureFile);
+	captureFile = NULL;
+
+	for(int i = 0; i < CAPTURE_SLOTS; ++i)
+	{
+		free(captureSlots[i]);
+		captureSlots[i] = NULL;
+	}
+	free(capturePlanes);
+	capturePlanes = NULL;
+}
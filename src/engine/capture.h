@@ -0,0 +1,38 @@
+//
+//  capture.h
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef capture_h
+#define capture_h
+
+#include <stddef.h>
+
+// frames read back and waiting for the writer thread, once all are taken new frames are dropped
+#define CAPTURE_SLOTS (4)
+
+struct SDL_Renderer;
+
+/**
+ * \brief Starts streaming rendered frames to path on a writer thread.
+ * \param path Written as YUV4MPEG2 when it ends in .y4m and as raw ARGB8888 frames otherwise.
+ * \param width The width of the stream, frames are cut from the top left of the renderer output.
+ * \param fps The frame rate recorded in the stream header.
+ * \returns 0 on success.
+ */
+extern int captureOpen(const char* path, int width, int height, int fps);
+
+/**
+ * \brief Reads back what has been rendered so far and hands it to the writer thread.
+ * \note Call on the render thread before presenting, never blocks on the writer.
+ */
+extern void captureFrame(struct SDL_Renderer* renderer);
+
+/**
+ * \brief Writes the frames still waiting, closes the stream and logs how many frames were dropped.
+ */
+extern void captureClose(void);
+
+#endif /* capture_h */
@@ -0,0 +1,217 @@
+//
+//  cmd.c
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "cmd.h"
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+// keeps component data aligned for any component type
+#define CMD_DATA_ALIGN (16)
+
+// buffers of every thread that has recorded a command
+cmd_buffer_t* cmdBuffers;
+SDL_SpinLock cmdBuffersLock;
+
+static _Thread_local cmd_buffer_t* cmdLocalBuffer;
+
+// commands gathered from all buffers while flushing
+cmd_t* cmdSorted;
+size_t cmdSortedCapacity;
+
+static cmd_buffer_t* cmdGetLocalBuffer(void)
+{
+	if(cmdLocalBuffer != NULL)
+		return cmdLocalBuffer;
+
+	cmd_buffer_t* buffer = calloc(1, sizeof(cmd_buffer_t));
+	if(buffer == NULL)
+		return NULL;
+
+	SDL_AtomicLock(&cmdBuffersLock);
+	buffer->next = cmdBuffers;
+	cmdBuffers = buffer;
+	SDL_AtomicUnlock(&cmdBuffersLock);
+
+	return (cmdLocalBuffer = buffer);
+}
+
+static cmd_t* cmdAppend(cmd_type_t type, uint64_t sortKey, ecsEntityId entity, ecsComponentMask components)
+{
+	cmd_buffer_t* buffer = cmdGetLocalBuffer();
+	if(buffer == NULL)
+		return NULL;
+
+	if(buffer->count >= buffer->capacity)
+	{
+		size_t capacity = buffer->capacity > 0 ? buffer->capacity * 2 : 64;
+		cmd_t* commands = realloc(buffer->commands, capacity * sizeof(cmd_t));
+		if(commands == NULL)
+			return NULL;
+		buffer->commands = commands;
+		buffer->capacity = capacity;
+	}
+
+	cmd_t* command = &buffer->commands[buffer->count++];
+	*command = (cmd_t){
+		.sortKey = sortKey,
+		.type = type,
+		.entity = entity,
+		.components = components,
+		.buffer = buffer
+	};
+	return command;
+}
+
+void* cmdCreateEntity(uint64_t sortKey, ecsComponentMask components, ecsComponentMask dataComponent, size_t size)
+{
+	cmd_t* command = cmdAppend(CMD_CREATE, sortKey, noentity, components);
+	if(command == NULL)
+		return NULL;
+
+	cmd_buffer_t* buffer = command->buffer;
+	size_t offset = (buffer->dataSize + CMD_DATA_ALIGN - 1) & ~(size_t)(CMD_DATA_ALIGN - 1);
+
+	if(offset + size > buffer->dataCapacity)
+	{
+		size_t capacity = buffer->dataCapacity > 0 ? buffer->dataCapacity : 1024;
+		while(capacity < offset + size)
+			capacity *= 2;
+		char* data = realloc(buffer->data, capacity);
+		if(data == NULL)
+		{
+			--buffer->count;
+			return NULL;
+		}
+		buffer->data = data;
+		buffer->dataCapacity = capacity;
+	}
+
+	command->dataComponent = dataComponent;
+	command->dataOffset = offset;
+	command->dataSize = size;
+	buffer->dataSize = offset + size;
+
+	return buffer->data + offset;
+}
+
+void cmdDestroyEntity(uint64_t sortKey, ecsEntityId entity)
+{
+	cmdAppend(CMD_DESTROY, sortKey, entity, nocomponent);
+}
+
+void cmdAttachComponents(uint64_t sortKey, ecsEntityId entity, ecsComponentMask components)
+{
+	cmdAppend(CMD_ATTACH, sortKey, entity, components);
+}
+
+void cmdDetachComponents(uint64_t sortKey, ecsEntityId entity, ecsComponentMask components)
+{
+	cmdAppend(CMD_DETACH, sortKey, entity, components);
+}
+
+static int cmdCompare(const void* a, const void* b)
+{
+	const cmd_t* l = a, *r = b;
+	// which thread recorded a command depends on scheduling, so ties are broken by content only
+	if(l->sortKey != r->sortKey) return l->sortKey < r->sortKey ? -1 : 1;
+	if(l->type != r->type) return l->type < r->type ? -1 : 1;
+	if(l->entity != r->entity) return l->entity < r->entity ? -1 : 1;
+	if(l->components != r->components) return l->components < r->components ? -1 : 1;
+	return 0;
+}
+
+static void cmdApply(cmd_t* command)
+{
+	ecsEntityId entity;
+	void* component;
+
+	switch(command->type)
+	{
+	case CMD_CREATE:
+		if((entity = ecsCreateEntity(command->components)) == noentity)
+		{
+			SDL_Log("Failed to create entity from command buffer");
+			break;
+		}
+		if(command->dataSize > 0 && (component = ecsGetComponentPtr(entity, command->dataComponent)) != NULL)
+			memcpy(component, command->buffer->data + command->dataOffset, command->dataSize);
+		break;
+	case CMD_DESTROY:
+		ecsDestroyEntity(command->entity);
+		break;
+	case CMD_ATTACH:
+		ecsAttachComponents(command->entity, command->components);
+		break;
+	case CMD_DETACH:
+		ecsDetachComponents(command->entity, command->components);
+		break;
+	}
+}
+
+size_t cmdFlush(void)
+{
+	size_t count = 0;
+	cmd_buffer_t* buffer;
+
+	for(buffer = cmdBuffers; buffer != NULL; buffer = buffer->next)
+		count += buffer->count;
+
+	if(count == 0)
+		return 0;
+
+	if(count > cmdSortedCapacity)
+	{
+		cmd_t* sorted = realloc(cmdSorted, count * sizeof(cmd_t));
+		if(sorted == NULL)
+		{
+			SDL_Log("Failed to allocate %zu commands, dropping them", count);
+			count = 0;
+			goto clear;
+		}
+		cmdSorted = sorted;
+		cmdSortedCapacity = count;
+	}
+
+	// gather and order the commands of all threads
+	count = 0;
+	for(buffer = cmdBuffers; buffer != NULL; buffer = buffer->next)
+	{
+		memcpy(cmdSorted + count, buffer->commands, buffer->count * sizeof(cmd_t));
+		count += buffer->count;
+	}
+	qsort(cmdSorted, count, sizeof(cmd_t), &cmdCompare);
+
+	for(size_t i = 0; i < count; ++i)
+		cmdApply(&cmdSorted[i]);
+
+	ecsRunTasks();
+
+clear:
+	for(buffer = cmdBuffers; buffer != NULL; buffer = buffer->next)
+		buffer->count = buffer->dataSize = 0;
+
+	return count;
+}
+
+void cmdTerminate(void)
+{
+	cmd_buffer_t* buffer, *next;
+	for(buffer = cmdBuffers; buffer != NULL; buffer = next)
+	{
+		next = buffer->next;
+		free(buffer->commands);
+		free(buffer->data);
+		free(buffer);
+	}
+	cmdBuffers = NULL;
+	cmdLocalBuffer = NULL;
+
+	free(cmdSorted);
+	cmdSorted = NULL;
+	cmdSortedCapacity = 0;
+}
@@ -0,0 +1,68 @@
+//
+//  cmd.h
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef cmd_h
+#define cmd_h
+
+#include <ecs.h>
+#include <stdint.h>
+
+typedef enum cmd_type_t {
+	CMD_CREATE = 0x0,
+	CMD_DESTROY,
+	CMD_ATTACH,
+	CMD_DETACH,
+} cmd_type_t;
+
+// a structural change recorded while systems run and applied by cmdFlush
+typedef struct cmd_t {
+	uint64_t sortKey;
+	cmd_type_t type;
+	ecsEntityId entity;
+	ecsComponentMask components;
+	ecsComponentMask dataComponent; // component of a created entity initialized from data
+	size_t dataOffset, dataSize;
+	struct cmd_buffer_t* buffer;
+} cmd_t;
+
+// commands recorded by one thread, only that thread appends to it
+typedef struct cmd_buffer_t {
+	cmd_t* commands;
+	size_t count, capacity;
+	char* data;
+	size_t dataSize, dataCapacity;
+	struct cmd_buffer_t* next;
+} cmd_buffer_t;
+
+/**
+ * \brief Records the creation of an entity.
+ * \param sortKey Commands are applied in order of sortKey, keys should be unique and not depend on thread scheduling.
+ * \param components The components of the new entity.
+ * \param dataComponent The component initialized with the returned memory, must be one of components.
+ * \param size The size of dataComponent.
+ * \returns Memory to write the initial value of dataComponent to, valid until the next cmd call on this thread.
+ * \returns NULL if allocation failed.
+ * \note Safe to call from systems running on any number of threads.
+ */
+extern void* cmdCreateEntity(uint64_t sortKey, ecsComponentMask components, ecsComponentMask dataComponent, size_t size);
+extern void cmdDestroyEntity(uint64_t sortKey, ecsEntityId entity);
+extern void cmdAttachComponents(uint64_t sortKey, ecsEntityId entity, ecsComponentMask components);
+extern void cmdDetachComponents(uint64_t sortKey, ecsEntityId entity, ecsComponentMask components);
+
+/**
+ * \brief Applies the commands recorded on all threads in order of their sort keys and clears them.
+ * \returns The number of commands applied.
+ * \note Must be called outside of ecsRunSystems, while no thread is recording.
+ */
+extern size_t cmdFlush(void);
+
+/**
+ * \brief Frees all command buffers, call once threads that recorded commands have stopped.
+ */
+extern void cmdTerminate(void);
+
+#endif /* cmd_h */
@@ -0,0 +1,125 @@
+//
+//  ecs_system.hpp
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef ecs_system_hpp
+#define ecs_system_hpp
+
+#include <ecs.h>
+#include <assert.h>
+#include <tuple>
+#include <type_traits>
+
+// Typed systems over ecs.h.
+// A system is a kernel type constructed once per chunk from the delta time and called once per entity
+// with references to the components it was declared with, e.g.
+//
+//	struct move {
+//		float delta_time;
+//		move(float delta_time) : delta_time(delta_time) {}
+//		void operator()(boid_c& boid) const { ... }
+//	};
+//	ecs::enable<move, boid_c>(8, 50);
+//
+// The kernel is a template parameter so its body is inlined into the loop instead of called through a pointer.
+// ecs.h keeps every component type in one list indexed by entity id and strided by the registered size,
+// so entities with consecutive ids have their components next to each other. A run of consecutive ids
+// costs one ecsGetComponentPtr per component type and is then walked as typed columns,
+// which leaves the compiler free to vectorise the loop.
+// Component types may be listed as const when a system only reads them.
+namespace ecs {
+
+// maps a component type to the mask and the size it was registered with, specialise once for every component type
+//	template<> struct ecs::component<boid_c> {
+//		static ecsComponentMask mask() { return boid_component; }
+//		static size_t size() { return boid_component_size; }
+//	};
+template<typename T> struct component;
+
+template<typename T>
+inline ecsComponentMask maskOf()
+{
+	return component<std::remove_const_t<T>>::mask();
+}
+
+template<typename... Ts>
+inline ecsComponentMask mask()
+{
+	return (maskOf<Ts>() | ... | nocomponent);
+}
+
+// storage is strided by the registered size, a type whose size differs in C++ can never be walked as a column
+template<typename T>
+inline bool registeredSize()
+{
+	return component<std::remove_const_t<T>>::size() == sizeof(T);
+}
+
+template<typename T>
+inline T* get(ecsEntityId entity)
+{
+	return static_cast<T*>(ecsGetComponentPtr(entity, maskOf<T>()));
+}
+
+template<typename Kernel, typename... Ts>
+inline void run(Kernel& kernel, size_t count, Ts* __restrict... columns)
+{
+	for(size_t i = 0; i < count; ++i)
+		kernel(columns[i]...);
+}
+
+template<typename Kernel, typename... Ts>
+inline void dispatch(ecsEntityId* entities, size_t count, float deltaTime)
+{
+	static_assert(sizeof...(Ts) > 0, "a system needs at least one component type");
+	assert((registeredSize<Ts>() && ...));
+
+	Kernel kernel(deltaTime);
+	size_t first = 0, length;
+
+	while(first < count)
+	{
+		std::tuple<Ts*...> columns(get<Ts>(entities[first])...);
+		assert(((std::get<Ts*>(columns) != nullptr) && ...));
+
+		// the components of consecutive ids follow each other, so the run only has to compare ids
+		for(length = 1; first + length < count
+			&& entities[first + length] == entities[first] + length; ++length)
+			assert(((get<Ts>(entities[first + length]) == std::get<Ts*>(columns) + length) && ...));
+
+		run<Kernel, Ts...>(kernel, length, std::get<Ts*>(columns)...);
+		first += length;
+	}
+}
+
+/**
+ * \brief Runs Kernel for every entity of a chunk, matches the signature of ecsSystemFn.
+ */
+template<typename Kernel, typename... Ts>
+void each(ecsEntityId* entities, ecsComponentMask* components, size_t count, float deltaTime)
+{
+	dispatch<Kernel, Ts...>(entities, count, deltaTime);
+}
+
+/**
+ * \brief Enables a typed system for all entities that have every one of the component types Ts.
+ * \note maxThreads and executionOrder are passed on to ecsEnableSystem.
+ */
+template<typename Kernel, typename... Ts>
+inline void enable(int maxThreads, int executionOrder)
+{
+	ecsEnableSystem(&each<Kernel, Ts...>, mask<Ts...>(), ECS_QUERY_ALL, maxThreads, executionOrder);
+}
+
+template<typename Kernel, typename... Ts>
+inline void disable()
+{
+	ecsDisableSystem(&each<Kernel, Ts...>);
+}
+
+}
+
+#endif /* ecs_system_hpp */
@@ -4,25 +4,42 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdlib.h>
-#include <time.h>
 #include <ecs.h>
 #include "adb.h"
 #include "ui.h"
+#include "tune.h"
+#include "cmd.h"
+#include "arena.h"
+#include "perf.h"
+#include "capture.h"
 
 SDL_Window* window;
 SDL_Renderer* renderer;
+SDL_Thread* sim_thread;
 int engine_wants_to_quit;
-float frame_start_time;
-float last_frame_time;
-short is_render_frame;
-float target_frame_time;
-float render_frame_time;
-
-void system_window_clear(ecsEntityId* entities, ecsComponentMask* components, size_t size, float delta_time);
-void system_window_display(ecsEntityId* entities, ecsComponentMask* components, size_t size, float delta_time);
+short engine_pipelined;
+short engine_headless;
+uint64_t engine_steps, engine_max_steps;
+double frame_start_time;
+double last_frame_time;
+double target_frame_time;
+double target_step_time;
+double fixed_delta_time;
+double next_render_time;
+double next_step_time;
+// how late sleeping tends to wake up, the last stretch before a deadline is spun instead
+double step_sleep_slack = 0.002;
+double render_sleep_slack = 0.002;
+// input and output size captured by the render thread for the sim thread
+int mouse_x, mouse_y;
+uint32_t mouse_buttons;
+int output_w, output_h;
 
 void engine_init();
 void engine_run();
+void engine_step();
+void engine_render();
+void engine_wait_until(double deadline, double* sleep_slack);
 void engine_handle_event(SDL_Event* event);
 void engine_clean();
 
@@ -68,7 +85,7 @@ int main(int argc, char* argv[])
 void engine_init()
 {
 	// set the frame start time here to ensure there will be time passed when engine_run is called
-	frame_start_time = (float)clock() / CLOCKS_PER_SEC;
+	frame_start_time = engine_time();
 	engine_wants_to_quit = 0;
 	// init asset database for 100 assets
 	init_asset_database(100);
@@ -85,7 +102,28 @@ void engine_init()
 	default_engine_init_settings(&init_settings);
 	// allow sim to adjust init settings as needed
 	sim_config(&init_settings);
-	target_frame_time = 1.f/(float)init_settings.target_framerate;
+	target_frame_time = 1.0/(double)init_settings.target_framerate;
+	target_step_time = init_settings.target_simrate > 0 ? 1.0/(double)init_settings.target_simrate : 0.0;
+	fixed_delta_time = init_settings.fixed_delta_time;
+	tuneEnabled = init_settings.tune_threads;
+	engine_pipelined = init_settings.pipelined;
+	engine_headless = init_settings.headless;
+	engine_max_steps = init_settings.max_steps;
+	perfEnabled = init_settings.hw_counters;
+	
+	// headless runs have nothing to show, only events for ctrl-c and timers
+	if(engine_headless)
+	{
+		SDL_Init((init_settings.sdl_init_flags & ~SDL_INIT_VIDEO) | SDL_INIT_EVENTS);
+		renderer = NULL;
+		output_w = init_settings.window_width;
+		output_h = init_settings.window_height;
+		
+		ecsInit();
+		sim_init();
+		ecsRunTasks();
+		return;
+	}
 
 	// init sdl, create window and create renderer from window
 	SDL_Init(init_settings.sdl_init_flags);
@@ -109,40 +147,200 @@ void engine_init()
 	{
 		exit(2);
 	}
+	
+	// with vsync presenting blocks until the next refresh, rendering faster than that only stalls the sim
+	SDL_RendererInfo renderer_info;
+	SDL_DisplayMode display_mode;
+	if(SDL_GetRendererInfo(renderer, &renderer_info) == 0
+	   && (renderer_info.flags & SDL_RENDERER_PRESENTVSYNC) != 0
+	   && SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &display_mode) == 0
+	   && display_mode.refresh_rate > 0
+	   && target_frame_time < 1.0/(double)display_mode.refresh_rate)
+	{
+		target_frame_time = 1.0/(double)display_mode.refresh_rate;
+	}
 
 	// initialize runtime object database
 	ecsInit();
 
 	// initialize imgui renderer
 	uiInit(renderer);
-
-	// enable screen refresh system
-	ecsEnableSystem(&system_window_clear, nocomponent, ECS_NOQUERY, 0, -100);
+	SDL_GetRendererOutputSize(renderer, &output_w, &output_h);
+	
+	// record at the size the window opened with and the rate frames are rendered at
+	// a run that was asked to record is useless without the recording
+	if(init_settings.capture_path != NULL
+	   && captureOpen(init_settings.capture_path, output_w, output_h, (int)(1.0/target_frame_time + 0.5)) != 0)
+	{
+		SDL_Log("Failed to start capturing %dx%d to %s", output_w, output_h, init_settings.capture_path);
+		exit(3);
+	}
 	
 	// initialize sim
 	sim_init();
 	
-	ecsEnableSystem(&system_window_display, nocomponent, ECS_NOQUERY, 0, 10000);
 	// run created tasks
 	ecsRunTasks();
 }
 
+static int engine_sim_thread(void* data)
+{
+	while(!__atomic_load_n(&engine_wants_to_quit, __ATOMIC_ACQUIRE))
+	{
+		engine_step();
+	}
+	return 0;
+}
+
 void engine_run()
 {
 	SDL_Event evt;
-	float actual_time;
+	double now;
+	
+	next_step_time = next_render_time = engine_time();
 	
-	while(!engine_wants_to_quit)
+	// without a window there is no frame rate to keep and the sim renders what it needs itself
+	if(engine_headless)
 	{
-		last_frame_time = frame_start_time;
-		frame_start_time = (float)clock() / CLOCKS_PER_SEC;
-		
-		ecsRunSystems(frame_start_time - last_frame_time);
+		while(!__atomic_load_n(&engine_wants_to_quit, __ATOMIC_ACQUIRE))
+		{
+			engine_step();
+			sim_render_headless();
+			
+			while(SDL_PollEvent(&evt))
+			{
+				engine_handle_event(&evt);
+			}
+		}
+		return;
+	}
+	
+	// the sim steps frame n+1 while this thread draws frame n from the last published snapshot
+	if(engine_pipelined)
+	{
+		sim_thread = SDL_CreateThread(&engine_sim_thread, "sim", NULL);
+		if(sim_thread == NULL)
+			SDL_Log("Failed to create sim thread, stepping on the main thread: %s", SDL_GetError());
+	}
+	
+	while(!__atomic_load_n(&engine_wants_to_quit, __ATOMIC_ACQUIRE))
+	{
+		// without a sim thread render frames are the steps where a frame is due
+		if(sim_thread != NULL)
+			engine_wait_until(next_render_time, &render_sleep_slack);
+		else
+			engine_step();
 		
 		while(SDL_PollEvent(&evt))
 		{
 			engine_handle_event(&evt);
 		}
+		
+		now = engine_time();
+		if(now >= next_render_time)
+		{
+			next_render_time += target_frame_time;
+			// drop frames rather than rendering back to back after a stall
+			if(next_render_time < now)
+				next_render_time = now + target_frame_time;
+			
+			engine_render();
+		}
+	}
+	
+	if(sim_thread != NULL)
+	{
+		SDL_WaitThread(sim_thread, NULL);
+		sim_thread = NULL;
+	}
+}
+
+void engine_step()
+{
+	// sleep until the next sim step
+	if(target_step_time > 0.0)
+		engine_wait_until(next_step_time, &step_sleep_slack);
+	
+	last_frame_time = frame_start_time;
+	frame_start_time = engine_time();
+	
+	// catch up on a few late steps, but not on a long stall
+	next_step_time += target_step_time;
+	if(next_step_time < frame_start_time - target_step_time * 4.0)
+		next_step_time = frame_start_time;
+	
+	ecsRunSystems(fixed_delta_time > 0.0 ? fixed_delta_time : frame_start_time - last_frame_time);
+	// apply entities created and destroyed by systems while they ran
+	cmdFlush();
+	tuneEndFrame();
+	
+	if(engine_max_steps > 0 && ++engine_steps >= engine_max_steps)
+		__atomic_store_n(&engine_wants_to_quit, 1, __ATOMIC_RELEASE);
+}
+
+void engine_render()
+{
+	int x, y, w, h;
+	uint32_t buttons = SDL_GetMouseState(&x, &y);
+	__atomic_store_n(&mouse_x, x, __ATOMIC_RELAXED);
+	__atomic_store_n(&mouse_y, y, __ATOMIC_RELAXED);
+	__atomic_store_n(&mouse_buttons, buttons, __ATOMIC_RELAXED);
+	
+	SDL_GetRendererOutputSize(renderer, &w, &h);
+	__atomic_store_n(&output_w, w, __ATOMIC_RELAXED);
+	__atomic_store_n(&output_h, h, __ATOMIC_RELAXED);
+	
+	// clear screen all black
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	SDL_RenderClear(renderer);
+	
+	sim_render();
+	
+	// the back buffer is undefined once presented, so read it back before
+	captureFrame(renderer);
+	
+	// swap buffer
+	SDL_RenderPresent(renderer);
+}
+
+uint32_t engine_mouse_state(int* x, int* y)
+{
+	if(x != NULL) *x = __atomic_load_n(&mouse_x, __ATOMIC_RELAXED);
+	if(y != NULL) *y = __atomic_load_n(&mouse_y, __ATOMIC_RELAXED);
+	return __atomic_load_n(&mouse_buttons, __ATOMIC_RELAXED);
+}
+
+void engine_output_size(int* w, int* h)
+{
+	*w = __atomic_load_n(&output_w, __ATOMIC_RELAXED);
+	*h = __atomic_load_n(&output_h, __ATOMIC_RELAXED);
+}
+
+double engine_time()
+{
+	return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+// sleep until shortly before deadline and spin for the rest, so waking up is both cheap and on time
+void engine_wait_until(double deadline, double* sleep_slack)
+{
+	double now = engine_time(), requested, overshoot;
+	
+	while(deadline - now > *sleep_slack)
+	{
+		requested = deadline - now - *sleep_slack;
+		SDL_Delay(requested >= 0.001 ? (uint32_t)(requested * 1000.0) : 1);
+		
+		// track how late the os wakes us so the spin covers it
+		overshoot = engine_time() - now - requested;
+		now = engine_time();
+		*sleep_slack = overshoot > *sleep_slack ? overshoot : *sleep_slack * 0.99 + overshoot * 0.01;
+		*sleep_slack = *sleep_slack < 0.0005 ? 0.0005 : *sleep_slack > 0.004 ? 0.004 : *sleep_slack;
+	}
+	
+	while(now < deadline)
+	{
+		now = engine_time();
 	}
 }
 
@@ -152,44 +350,32 @@ void engine_handle_event(SDL_Event* event)
 	{
 	default: break;
 	case SDL_QUIT:
-		engine_wants_to_quit = 1;
+		__atomic_store_n(&engine_wants_to_quit, 1, __ATOMIC_RELEASE);
 		break;
 	}
 }
 
 void engine_clean()
 {
+	// report the thread counts systems settled on and memory use, before sim_quit releases it
+	tuneReport();
+	arenaReport();
 	// quit sim, ui asset database, ecs
 	sim_quit();
-	uiTerminate();
+	if(!engine_headless)
+		uiTerminate();
 	close_asset_database();
 	ecsTerminate();
+	cmdTerminate();
+	perfTerminate();
+	captureClose();
 	// delete renderer and window, quit sdl
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
-	SDL_Quit();
-}
-
-void system_window_clear(ecsEntityId* entities, ecsComponentMask* components, size_t size, float delta_time)
-{
-	render_frame_time += delta_time;
-	is_render_frame = render_frame_time >= target_frame_time;
-	
-	if(is_render_frame)
+	if(!engine_headless)
 	{
-		render_frame_time = 0;
-		// clear screen all black
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderClear(renderer);
-	}
-}
-void system_window_display(ecsEntityId* entities, ecsComponentMask* components, size_t size, float delta_time)
-{
-	if(is_render_frame)
-	{
-		// swap buffer
-		SDL_RenderPresent(renderer);
+		SDL_DestroyRenderer(renderer);
+		SDL_DestroyWindow(window);
 	}
+	SDL_Quit();
 }
 
 void default_engine_init_settings(engine_init_t* init_settings)
@@ -200,7 +386,15 @@ void default_engine_init_settings(engine_init_t* init_settings)
 		.sdl_init_flags = SDL_INIT_VIDEO,
 		.renderer_init_flags = SDL_RENDERER_ACCELERATED,
 		.renderer_index = -1,
-		.target_framerate = 60
+		.target_framerate = 60,
+		.target_simrate = 120,
+		.fixed_delta_time = 0.0,
+		.tune_threads = 1,
+		.pipelined = 1,
+		.hw_counters = 0,
+		.capture_path = NULL,
+		.headless = 0,
+		.max_steps = 0
 	};
 }
 
@@ -10,14 +10,28 @@ typedef struct engine_init_t {
 	uint32_t renderer_init_flags;
 	int renderer_index;
 	int target_framerate;
+	int target_simrate; // sim steps per second, 0 to step as fast as possible
+	double fixed_delta_time; // sim seconds every step advances by, 0 to advance by the time that actually passed
+	short tune_threads;
+	short pipelined; // step the sim on its own thread while the main thread renders
+	short hw_counters; // read hardware performance counters around tuned systems, linux only
+	const char* capture_path; // stream rendered frames to this .y4m or raw file, NULL to not capture
+	short headless; // run without a window or renderer, calling sim_render_headless after every step
+	uint64_t max_steps; // quit after this many sim steps, 0 to run until closed
 } engine_init_t;
 
-extern short is_render_frame;
-
 extern void default_engine_init_settings(engine_init_t*);
+extern double engine_time();
+// mouse state and renderer output size as of the last rendered frame, safe to call from the sim thread
+extern uint32_t engine_mouse_state(int* x, int* y);
+extern void engine_output_size(int* w, int* h);
 
 extern void sim_config(engine_init_t*);
 extern void sim_init();
+// draws the last state published by the sim, called on the render thread with the screen cleared
+extern void sim_render();
+// called after every step of a headless run in place of sim_render
+extern void sim_render_headless();
 extern void sim_quit();
 
 extern struct SDL_Renderer* renderer;
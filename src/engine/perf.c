@@ -0,0 +1,167 @@
+//
+//  perf.c
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "perf.h"
+#include <SDL2/SDL.h>
+#include <string.h>
+
+short perfEnabled = 0;
+
+void perfDelta(const perf_sample_t* begin, const perf_sample_t* end, uint64_t counts[PERF_COUNTERS])
+{
+	uint64_t enabled = end->timeEnabled - begin->timeEnabled;
+	uint64_t running = end->timeRunning - begin->timeRunning;
+	// scale the interval rather than each running count, whose ratio changes whenever the kernel multiplexes
+	double scale = running > 0 && running < enabled ? (double)enabled / (double)running : 1.0;
+
+	for(int i = 0; i < PERF_COUNTERS; ++i)
+	{
+		counts[i] = end->counts[i] > begin->counts[i]
+			? (uint64_t)((double)(end->counts[i] - begin->counts[i]) * scale) : 0;
+	}
+}
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// counters opened by one thread, the first one that opened leads the group
+typedef struct perf_thread_t {
+	int fds[PERF_COUNTERS];
+	int slots[PERF_COUNTERS]; // position of each counter in a group read, -1 if it failed to open
+	int opened;
+	struct perf_thread_t* next;
+} perf_thread_t;
+
+static const uint64_t perfConfigs[PERF_COUNTERS] = {
+	[PERF_CYCLES] = PERF_COUNT_HW_CPU_CYCLES,
+	[PERF_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+	[PERF_CACHE_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+	[PERF_BRANCH_MISSES] = PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+perf_thread_t* perfThreads;
+SDL_SpinLock perfThreadsLock;
+int perfUnavailableLogged;
+
+static _Thread_local perf_thread_t* perfLocal;
+static _Thread_local short perfLocalFailed;
+
+static perf_thread_t* perfOpenThread(void)
+{
+	struct perf_event_attr attr;
+	perf_thread_t* thread = calloc(1, sizeof(perf_thread_t));
+	int leader = -1, fd;
+
+	if(thread == NULL)
+		return NULL;
+
+	for(int i = 0; i < PERF_COUNTERS; ++i)
+	{
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = perfConfigs[i];
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		// user space only, which is all a system is and what unprivileged processes may count
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+		thread->fds[i] = fd;
+		thread->slots[i] = fd >= 0 ? thread->opened++ : -1;
+		if(fd >= 0 && leader < 0)
+			leader = fd;
+	}
+
+	if(thread->opened == 0)
+	{
+		if(__atomic_exchange_n(&perfUnavailableLogged, 1, __ATOMIC_RELAXED) == 0)
+			SDL_Log("Hardware counters unavailable, continuing without them: %s", strerror(errno));
+		free(thread);
+		return NULL;
+	}
+
+	SDL_AtomicLock(&perfThreadsLock);
+	thread->next = perfThreads;
+	perfThreads = thread;
+	SDL_AtomicUnlock(&perfThreadsLock);
+
+	return thread;
+}
+
+short perfRead(perf_sample_t* sample)
+{
+	// nr, time enabled, time running, then one value per opened counter
+	uint64_t values[3 + PERF_COUNTERS];
+	int leader = -1;
+
+	if(!perfEnabled || perfLocalFailed)
+		return 0;
+
+	if(perfLocal == NULL && (perfLocal = perfOpenThread()) == NULL)
+	{
+		perfLocalFailed = 1;
+		return 0;
+	}
+
+	for(int i = 0; i < PERF_COUNTERS && leader < 0; ++i)
+		leader = perfLocal->fds[i];
+
+	if(read(leader, values, sizeof(values)) < (ssize_t)(3 * sizeof(uint64_t)))
+		return 0;
+
+	sample->timeEnabled = values[1];
+	sample->timeRunning = values[2];
+	for(int i = 0; i < PERF_COUNTERS; ++i)
+	{
+		sample->counts[i] = perfLocal->slots[i] >= 0 && (uint64_t)perfLocal->slots[i] < values[0]
+			? values[3 + perfLocal->slots[i]] : 0;
+	}
+
+	return 1;
+}
+
+void perfTerminate(void)
+{
+	perf_thread_t* thread, *next;
+	for(thread = perfThreads; thread != NULL; thread = next)
+	{
+		next = thread->next;
+		for(int i = PERF_COUNTERS - 1; i >= 0; --i)
+		{
+			if(thread->fds[i] >= 0)
+				close(thread->fds[i]);
+		}
+		free(thread);
+	}
+	perfThreads = NULL;
+	perfLocal = NULL;
+}
+
+#else
+
+short perfRead(perf_sample_t* sample)
+{
+	static short logged = 0;
+	if(perfEnabled && !logged)
+	{
+		logged = 1;
+		SDL_Log("Hardware counters are only available on linux, continuing without them");
+	}
+	return 0;
+}
+
+void perfTerminate(void)
+{
+}
+
+#endif
@@ -0,0 +1,51 @@
+//
+//  perf.h
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef perf_h
+#define perf_h
+
+#include <stdint.h>
+
+typedef enum perf_counter_t {
+	PERF_CYCLES = 0x0,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_COUNTERS
+} perf_counter_t;
+
+// raw running counts of one thread and how long the counters were enabled and actually counting
+typedef struct perf_sample_t {
+	uint64_t counts[PERF_COUNTERS];
+	uint64_t timeEnabled;
+	uint64_t timeRunning;
+} perf_sample_t;
+
+// when 0 no counters are opened and perfRead always fails
+extern short perfEnabled;
+
+/**
+ * \brief Reads the hardware counters of the calling thread, opening them on first use.
+ * \param sample Receives the running count of each perf_counter_t, unscaled.
+ * \returns 1 if the counters could be read, counters that failed to open read as 0.
+ * \returns 0 if counting is disabled or not available on this system.
+ * \note Only available on linux through perf_event_open.
+ */
+extern short perfRead(perf_sample_t* sample);
+
+/**
+ * \brief Gets the counts between two reads of the same thread.
+ * \param counts Receives each count, scaled up by the share of the interval the kernel had the counters scheduled.
+ */
+extern void perfDelta(const perf_sample_t* begin, const perf_sample_t* end, uint64_t counts[PERF_COUNTERS]);
+
+/**
+ * \brief Closes the counters of all threads, call once threads that read counters have stopped.
+ */
+extern void perfTerminate(void);
+
+#endif /* perf_h */
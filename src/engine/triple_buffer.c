@@ -0,0 +1,46 @@
+//
+//  triple_buffer.c
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "triple_buffer.h"
+#include <stddef.h>
+
+void triple_buffer_init(triple_buffer_t* buffer, void* a, void* b, void* c)
+{
+	buffer->slots[0] = a;
+	buffer->slots[1] = b;
+	buffer->slots[2] = c;
+	buffer->back = 0;
+	buffer->middle = 1;
+	buffer->front = 2;
+}
+
+void* triple_buffer_back(triple_buffer_t* buffer)
+{
+	return buffer->slots[buffer->back];
+}
+
+void triple_buffer_publish(triple_buffer_t* buffer)
+{
+	int last = __atomic_exchange_n(&buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH, __ATOMIC_ACQ_REL);
+	buffer->back = last & ~TRIPLE_BUFFER_FRESH;
+}
+
+void* triple_buffer_acquire(triple_buffer_t* buffer, short* fresh)
+{
+	short is_fresh = (__atomic_load_n(&buffer->middle, __ATOMIC_RELAXED) & TRIPLE_BUFFER_FRESH) != 0;
+
+	if(is_fresh)
+	{
+		int last = __atomic_exchange_n(&buffer->middle, buffer->front, __ATOMIC_ACQ_REL);
+		buffer->front = last & ~TRIPLE_BUFFER_FRESH;
+	}
+
+	if(fresh != NULL)
+		*fresh = is_fresh;
+
+	return buffer->slots[buffer->front];
+}
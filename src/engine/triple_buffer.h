@@ -0,0 +1,41 @@
+//
+//  triple_buffer.h
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef triple_buffer_h
+#define triple_buffer_h
+
+// Passes whole buffers from one writer thread to one reader thread without either waiting on the other.
+// The writer fills the back buffer and publishes it, the reader always gets the most recently published buffer.
+typedef struct triple_buffer_t {
+	void* slots[3];
+	int back; // only touched by the writer
+	int front; // only touched by the reader
+	int middle; // slot index, or'ed with TRIPLE_BUFFER_FRESH when published but not yet read
+} triple_buffer_t;
+
+#define TRIPLE_BUFFER_FRESH (0x4)
+
+extern void triple_buffer_init(triple_buffer_t* buffer, void* a, void* b, void* c);
+
+/**
+ * \brief Gets the buffer the writer should fill next.
+ */
+extern void* triple_buffer_back(triple_buffer_t* buffer);
+
+/**
+ * \brief Hands the back buffer to the reader and gives the writer a new back buffer.
+ */
+extern void triple_buffer_publish(triple_buffer_t* buffer);
+
+/**
+ * \brief Gets the most recently published buffer.
+ * \param fresh Set to 1 if the buffer was published since the last call, may be NULL.
+ * \note The buffer stays valid for the reader until its next call.
+ */
+extern void* triple_buffer_acquire(triple_buffer_t* buffer, short* fresh);
+
+#endif /* triple_buffer_h */
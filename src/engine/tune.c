@@ -0,0 +1,236 @@
+//
+//  tune.c
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "tune.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdlib.h>
+
+// frames discarded after changing the thread count of a system
+#define TUNE_WARMUP_FRAMES (3)
+// relative change in entity count after which a settled system is tuned again
+#define TUNE_RETUNE_RATIO (0.5f)
+
+short tuneEnabled = 1;
+
+tune_system_t* tuneSystems;
+
+static void tuneApply(tune_system_t* system, int threads)
+{
+	system->warmup = TUNE_WARMUP_FRAMES;
+	system->sampleCount = 0;
+
+	if(threads == system->threads)
+		return;
+
+	system->threads = threads;
+	ecsDisableSystem(system->fn);
+	ecsEnableSystem(system->fn, system->components, system->comparison, threads, system->executionOrder);
+}
+
+static void tuneRestart(tune_system_t* system)
+{
+	system->settled = 0;
+	system->candidate = 0;
+	system->bestTime = INFINITY;
+	system->bestThreads = system->threads;
+	system->tunedEntities = system->lastEntities;
+	tuneApply(system, system->candidates[0]);
+}
+
+void tuneEnableSystemInstance(tune_system_t* system, ecsSystemFn fn, ecsComponentMask components,
+							  ecsQueryComparison comparison, int maxThreads, int executionOrder)
+{
+	int cpus = SDL_GetCPUCount();
+
+	system->fn = fn;
+	system->components = components;
+	system->comparison = comparison;
+	system->executionOrder = executionOrder;
+	system->threads = maxThreads;
+	system->frameStart = system->frameEnd = system->frameEntities = 0;
+
+	// try running inline, then powers of two up to maxThreads or twice the number of cores
+	system->candidateCount = 0;
+	system->candidates[system->candidateCount++] = 0;
+	for(int threads = 1; threads <= maxThreads && threads <= cpus * 2
+		&& system->candidateCount < TUNE_MAX_CANDIDATES; threads *= 2)
+	{
+		system->candidates[system->candidateCount++] = threads;
+	}
+
+	system->next = tuneSystems;
+	tuneSystems = system;
+
+	if(tuneEnabled && maxThreads > 0)
+	{
+		system->threads = system->candidates[0];
+		system->lastEntities = 0;
+		tuneRestart(system);
+	}
+	else
+	{
+		system->settled = 1;
+	}
+
+	ecsEnableSystem(fn, components, comparison, system->threads, executionOrder);
+}
+
+void tuneDisableSystem(tune_system_t* system)
+{
+	tune_system_t** link = &tuneSystems;
+	while(*link != NULL && *link != system)
+		link = &(*link)->next;
+	if(*link != NULL)
+		*link = system->next;
+
+	ecsDisableSystem(system->fn);
+}
+
+void tuneSystemBegin(tune_system_t* system, tune_sample_t* sample)
+{
+	uint64_t now = SDL_GetPerformanceCounter();
+	uint64_t start = __atomic_load_n(&system->frameStart, __ATOMIC_RELAXED);
+
+	// the frame starts when the first chunk of the system does
+	while((start == 0 || now < start)
+		  && !__atomic_compare_exchange_n(&system->frameStart, &start, now, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	sample->start = now;
+	// read counters last so that the bookkeeping above is not counted
+	sample->counted = perfRead(&sample->counters);
+}
+
+void tuneSystemEnd(tune_system_t* system, tune_sample_t* sample, size_t count)
+{
+	perf_sample_t read;
+	uint64_t counters[PERF_COUNTERS];
+	short counted = sample->counted && perfRead(&read);
+	uint64_t now = SDL_GetPerformanceCounter();
+	uint64_t end = __atomic_load_n(&system->frameEnd, __ATOMIC_RELAXED);
+
+	// and ends when the last chunk finishes
+	while(now > end
+		  && !__atomic_compare_exchange_n(&system->frameEnd, &end, now, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	__atomic_add_fetch(&system->frameEntities, count, __ATOMIC_RELAXED);
+
+	if(counted)
+	{
+		perfDelta(&sample->counters, &read, counters);
+		for(int i = 0; i < PERF_COUNTERS; ++i)
+			__atomic_add_fetch(&system->frameCounters[i], counters[i], __ATOMIC_RELAXED);
+		__atomic_add_fetch(&system->frameCountedEntities, count, __ATOMIC_RELAXED);
+	}
+}
+
+static int tuneCompareSamples(const void* a, const void* b)
+{
+	float l = *(const float*)a, r = *(const float*)b;
+	return l < r ? -1 : (l > r);
+}
+
+static void tuneSample(tune_system_t* system)
+{
+	if(system->settled)
+	{
+		// a settled choice only holds for a population of roughly the size it was tuned for
+		float change = fabsf((float)system->lastEntities - (float)system->tunedEntities);
+		if(tuneEnabled && system->candidateCount > 1
+		   && change > TUNE_RETUNE_RATIO * (float)(system->tunedEntities > 0 ? system->tunedEntities : 1))
+		{
+			tuneRestart(system);
+		}
+		return;
+	}
+
+	if(system->warmup > 0)
+	{
+		--system->warmup;
+		return;
+	}
+
+	system->samples[system->sampleCount++] = system->lastTime;
+	if(system->sampleCount < TUNE_SAMPLES)
+		return;
+
+	// the median holds up against the odd frame interrupted by the os
+	qsort(system->samples, TUNE_SAMPLES, sizeof(float), &tuneCompareSamples);
+	float median = system->samples[TUNE_SAMPLES / 2];
+	if(median < system->bestTime)
+	{
+		system->bestTime = median;
+		system->bestThreads = system->threads;
+	}
+
+	if(++system->candidate < system->candidateCount)
+	{
+		tuneApply(system, system->candidates[system->candidate]);
+		return;
+	}
+
+	system->settled = 1;
+	system->tunedEntities = system->lastEntities;
+	tuneApply(system, system->bestThreads);
+	SDL_Log("%s: %d threads, %.3fms for %zu entities", system->name, system->bestThreads,
+			system->bestTime * 1000.f, system->tunedEntities);
+}
+
+void tuneEndFrame(void)
+{
+	short changed = 0;
+	uint64_t frequency = SDL_GetPerformanceFrequency();
+
+	for(tune_system_t* system = tuneSystems; system != NULL; system = system->next)
+	{
+		// systems that did not run this frame have nothing to report
+		if(system->frameStart == 0)
+			continue;
+
+		system->lastTime = (float)(system->frameEnd - system->frameStart) / (float)frequency;
+		system->lastEntities = system->frameEntities;
+		system->frameStart = system->frameEnd = system->frameEntities = 0;
+
+		for(int i = 0; i < PERF_COUNTERS; ++i)
+		{
+			system->totalCounters[i] += system->frameCounters[i];
+			system->frameCounters[i] = 0;
+		}
+		system->totalCountedEntities += system->frameCountedEntities;
+		system->frameCountedEntities = 0;
+
+		int threads = system->threads;
+		tuneSample(system);
+		changed |= threads != system->threads;
+	}
+
+	// let the ecs pick up re-enabled systems before the next frame
+	if(changed)
+		ecsRunTasks();
+}
+
+void tuneReport(void)
+{
+	for(tune_system_t* system = tuneSystems; system != NULL; system = system->next)
+	{
+		SDL_Log("%s: %d threads%s, %.3fms for %zu entities", system->name, system->threads,
+				system->settled ? "" : " (tuning)", system->lastTime * 1000.f, system->lastEntities);
+
+		if(system->totalCountedEntities == 0)
+			continue;
+
+		// a low ipc with many cache misses per entity points at memory rather than compute
+		double entities = (double)system->totalCountedEntities;
+		uint64_t* counters = system->totalCounters;
+		SDL_Log("%s: %.2f instructions per cycle, %.1f cycles, %.2f cache misses and %.2f branch misses per entity",
+				system->name,
+				counters[PERF_CYCLES] > 0 ? (double)counters[PERF_INSTRUCTIONS] / (double)counters[PERF_CYCLES] : 0.0,
+				(double)counters[PERF_CYCLES] / entities,
+				(double)counters[PERF_CACHE_MISSES] / entities,
+				(double)counters[PERF_BRANCH_MISSES] / entities);
+	}
+}
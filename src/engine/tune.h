@@ -0,0 +1,99 @@
+//
+//  tune.h
+//  engine
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef tune_h
+#define tune_h
+
+#include <ecs.h>
+#include <stdint.h>
+#include "perf.h"
+
+#define TUNE_MAX_CANDIDATES (8)
+#define TUNE_SAMPLES (15)
+
+typedef struct tune_system_t {
+	const char* name;
+	ecsSystemFn fn;
+	ecsComponentMask components;
+	ecsQueryComparison comparison;
+	int executionOrder;
+	int threads;
+
+	// timings of the current frame, written from worker threads
+	uint64_t frameStart, frameEnd, frameEntities;
+	// hardware counters summed over the chunks of the current frame that could read them
+	uint64_t frameCounters[PERF_COUNTERS], frameCountedEntities;
+	// last completed frame
+	float lastTime;
+	size_t lastEntities;
+	// hardware counters summed over all frames
+	uint64_t totalCounters[PERF_COUNTERS], totalCountedEntities;
+
+	// thread counts to try, and how far along trying them the tuner is
+	int candidates[TUNE_MAX_CANDIDATES];
+	int candidateCount, candidate;
+	float samples[TUNE_SAMPLES];
+	int sampleCount, warmup;
+	float bestTime;
+	int bestThreads;
+	size_t tunedEntities;
+	short settled;
+
+	struct tune_system_t* next;
+} tune_system_t;
+
+// state of one chunk of a system between tuneSystemBegin and tuneSystemEnd
+typedef struct tune_sample_t {
+	uint64_t start;
+	perf_sample_t counters;
+	short counted;
+} tune_sample_t;
+
+// when 0 tuned systems keep the thread count they were enabled with
+extern short tuneEnabled;
+
+/**
+ * \brief Defines a timing wrapper for a system, use at file scope before enabling it with tuneEnableSystem.
+ */
+#define TUNE_SYSTEM(__fn)\
+static tune_system_t __fn##_tune = { .name = #__fn };\
+static void __fn##_tuned(ecsEntityId* entities, ecsComponentMask* components, size_t count, float deltaTime)\
+{\
+	tune_sample_t sample;\
+	tuneSystemBegin(&__fn##_tune, &sample);\
+	__fn(entities, components, count, deltaTime);\
+	tuneSystemEnd(&__fn##_tune, &sample, count);\
+}
+
+/**
+ * \brief Enables a system wrapped with TUNE_SYSTEM, searching for the thread count at which it runs fastest.
+ * \param maxThreads The largest thread count to try, systems enabled with 0 are only measured.
+ * \note The remaining parameters are passed on to ecsEnableSystem.
+ */
+#define tuneEnableSystem(__fn, components, comparison, maxThreads, executionOrder)\
+tuneEnableSystemInstance(&__fn##_tune, &__fn##_tuned, components, comparison, maxThreads, executionOrder)
+
+extern void tuneEnableSystemInstance(tune_system_t* system, ecsSystemFn fn, ecsComponentMask components,
+									 ecsQueryComparison comparison, int maxThreads, int executionOrder);
+extern void tuneDisableSystem(tune_system_t* system);
+
+extern void tuneSystemBegin(tune_system_t* system, tune_sample_t* sample);
+extern void tuneSystemEnd(tune_system_t* system, tune_sample_t* sample, size_t count);
+
+/**
+ * \brief Collects the timings of the frame that just ran and advances tuning.
+ * \note Must be called outside of ecsRunSystems.
+ */
+extern void tuneEndFrame(void);
+
+/**
+ * \brief Logs the thread count and last frame time of every tuned system,
+ * and its instructions per cycle and misses per entity when hardware counters were read.
+ */
+extern void tuneReport(void);
+
+#endif /* tune_h */
@@ -8,8 +8,46 @@
 #include "ui.h"
 #include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 SDL_Renderer* uiTarget;
+
+// widgets are recorded into one list per layer and drawn with a single SDL_RenderGeometry call each
+// when the next window begins and in uiEndFrame, so the text of a window goes on top of its own shapes
+// and windows stack in the order they were declared in
+typedef enum ui_layer_t {
+	UI_LAYER_SHAPES,
+	UI_LAYER_TEXT,
+	UI_LAYER_COUNT
+} ui_layer_t;
+
+typedef struct ui_draw_list_t {
+	SDL_Vertex* vertices;
+	int* indices;
+	int vertexCount, vertexCapacity;
+	int indexCount, indexCapacity;
+} ui_draw_list_t;
+
+ui_draw_list_t uiDrawLists[UI_LAYER_COUNT];
+
+// printable ascii rendered once per font and renderer, so every label of a frame samples the same texture
+#define UI_GLYPH_FIRST (32)
+#define UI_GLYPH_LAST (126)
+#define UI_ATLAS_WIDTH (512)
+
+typedef struct ui_glyph_t {
+	SDL_Rect rect;
+	int advance;
+} ui_glyph_t;
+
+struct ui_atlas_t {
+	SDL_Texture* texture;
+	int width, height;
+	int fontHeight;
+	ui_glyph_t glyphs[UI_GLYPH_LAST - UI_GLYPH_FIRST + 1];
+} uiAtlas;
+
 typedef struct ui_selection_t {
 	uintptr_t item;
 	short keepSelected;
@@ -71,23 +109,166 @@ short uiIsSelected(void* ptr)
 	return uiSelection.item == (intptr_t)ptr;
 }
 
+static void uiDestroyAtlas()
+{
+	if(uiAtlas.texture != NULL)
+		SDL_DestroyTexture(uiAtlas.texture);
+	memset(&uiAtlas, 0, sizeof(struct ui_atlas_t));
+}
+
+// render the glyphs of the current font and pack them row by row into one texture for the current target
+static void uiBuildAtlas()
+{
+	SDL_Surface* glyphs[UI_GLYPH_LAST - UI_GLYPH_FIRST + 1] = { NULL };
+	SDL_Color white = {255, 255, 255, 255};
+	int x = 0, y = 0, rowHeight = 0;
+	
+	uiDestroyAtlas();
+	
+	if(uiTarget == NULL || uiStyle.font == NULL)
+		return;
+	
+	uiAtlas.fontHeight = TTF_FontHeight(uiStyle.font);
+	uiAtlas.width = UI_ATLAS_WIDTH;
+	
+	for(int c = UI_GLYPH_FIRST; c <= UI_GLYPH_LAST; ++c)
+	{
+		ui_glyph_t* glyph = &uiAtlas.glyphs[c - UI_GLYPH_FIRST];
+		SDL_Surface* surface = TTF_RenderGlyph_Blended(uiStyle.font, c, white);
+		
+		if(TTF_GlyphMetrics(uiStyle.font, c, NULL, NULL, NULL, NULL, &glyph->advance) != 0)
+			glyph->advance = 0;
+		
+		if(surface == NULL)
+			continue;
+		
+		if(x + surface->w > uiAtlas.width)
+		{
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+		
+		glyph->rect = (SDL_Rect){ x, y, surface->w, surface->h };
+		x += surface->w;
+		rowHeight = surface->h > rowHeight ? surface->h : rowHeight;
+		glyphs[c - UI_GLYPH_FIRST] = surface;
+	}
+	uiAtlas.height = y + rowHeight;
+	
+	SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, uiAtlas.width, uiAtlas.height > 0 ? uiAtlas.height : 1, 32, SDL_PIXELFORMAT_ARGB8888);
+	if(atlas != NULL)
+	{
+		SDL_FillRect(atlas, NULL, 0);
+		for(int i = 0; i <= UI_GLYPH_LAST - UI_GLYPH_FIRST; ++i)
+		{
+			if(glyphs[i] == NULL)
+				continue;
+			// copy the glyph coverage as it is instead of blending it onto the empty atlas
+			SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(glyphs[i], NULL, atlas, &uiAtlas.glyphs[i].rect);
+		}
+		uiAtlas.texture = SDL_CreateTextureFromSurface(uiTarget, atlas);
+		SDL_FreeSurface(atlas);
+	}
+	
+	for(int i = 0; i <= UI_GLYPH_LAST - UI_GLYPH_FIRST; ++i)
+		SDL_FreeSurface(glyphs[i]);
+	
+	if(uiAtlas.texture == NULL)
+	{
+		SDL_Log("Failed to create glyph atlas, labels will not be drawn:\n%s", SDL_GetError());
+		return;
+	}
+	SDL_SetTextureBlendMode(uiAtlas.texture, SDL_BLENDMODE_BLEND);
+}
+
+// make room for n more vertices and indices in a draw list
+static short uiReserve(ui_draw_list_t* list, int vertices, int indices)
+{
+	if(list->vertexCount + vertices > list->vertexCapacity)
+	{
+		int capacity = list->vertexCapacity > 0 ? list->vertexCapacity * 2 : 256;
+		while(capacity < list->vertexCount + vertices)
+			capacity *= 2;
+		SDL_Vertex* grown = realloc(list->vertices, capacity * sizeof(SDL_Vertex));
+		if(grown == NULL)
+			return 0;
+		list->vertices = grown;
+		list->vertexCapacity = capacity;
+	}
+	
+	if(list->indexCount + indices > list->indexCapacity)
+	{
+		int capacity = list->indexCapacity > 0 ? list->indexCapacity * 2 : 384;
+		while(capacity < list->indexCount + indices)
+			capacity *= 2;
+		int* grown = realloc(list->indices, capacity * sizeof(int));
+		if(grown == NULL)
+			return 0;
+		list->indices = grown;
+		list->indexCapacity = capacity;
+	}
+	
+	return 1;
+}
+
+// record a quad covering dst, textured with the region (u0,v0)-(u1,v1) of the layer's texture
+static void uiPushQuad(ui_layer_t layer, SDL_FRect dst, SDL_Color colour, float u0, float v0, float u1, float v1)
+{
+	ui_draw_list_t* list = &uiDrawLists[layer];
+	
+	if(!uiReserve(list, 4, 6))
+		return;
+	
+	SDL_Vertex* v = list->vertices + list->vertexCount;
+	v[0] = (SDL_Vertex){ { dst.x, dst.y }, colour, { u0, v0 } };
+	v[1] = (SDL_Vertex){ { dst.x + dst.w, dst.y }, colour, { u1, v0 } };
+	v[2] = (SDL_Vertex){ { dst.x + dst.w, dst.y + dst.h }, colour, { u1, v1 } };
+	v[3] = (SDL_Vertex){ { dst.x, dst.y + dst.h }, colour, { u0, v1 } };
+	
+	int* i = list->indices + list->indexCount;
+	int first = list->vertexCount;
+	i[0] = first; i[1] = first + 1; i[2] = first + 2;
+	i[3] = first; i[4] = first + 2; i[5] = first + 3;
+	
+	list->vertexCount += 4;
+	list->indexCount += 6;
+}
+
+// record a filled rectangle
+static void uiPushRect(const SDL_Rect* rect, SDL_Color colour)
+{
+	SDL_FRect dst = { rect->x, rect->y, rect->w, rect->h };
+	uiPushQuad(UI_LAYER_SHAPES, dst, colour, 0.f, 0.f, 0.f, 0.f);
+}
+
 void uiInit(SDL_Renderer* target)
 {
 	uiTarget = target;
 	uiSelection.item = 0;
 	memset(&uiStyle, 0, sizeof(struct ui_style_t));
+	memset(&uiAtlas, 0, sizeof(struct ui_atlas_t));
+	memset(uiDrawLists, 0, sizeof(uiDrawLists));
 	uiUpdateMouseState();
 	uiStyle.indentPixels = 10;
 }
 
 void uiTerminate()
 {
-	
+	uiDestroyAtlas();
+	for(int i = 0; i < UI_LAYER_COUNT; ++i)
+	{
+		free(uiDrawLists[i].vertices);
+		free(uiDrawLists[i].indices);
+	}
+	memset(uiDrawLists, 0, sizeof(uiDrawLists));
 }
 
 void uiSetFont(TTF_Font* font)
 {
 	uiStyle.font = font;
+	uiBuildAtlas();
 }
 
 // check if a mouse button was pressed on this ui frame
@@ -118,7 +299,11 @@ short uiMouseButtonDown(uint32_t buttonMask)
 // change the SDL render target
 void uiSetTarget(SDL_Renderer* renderer)
 {
+	if(renderer == uiTarget)
+		return;
 	uiTarget = renderer;
+	// textures belong to the renderer that created them
+	uiBuildAtlas();
 }
 
 // begin a new frame
@@ -127,6 +312,37 @@ void uiBeginFrame()
 	if(uiSelection.keepSelected == 0)
 		uiSelection.item = 0;
 	uiUpdateMouseState();
+	
+	for(int i = 0; i < UI_LAYER_COUNT; ++i)
+	{
+		uiDrawLists[i].vertexCount = 0;
+		uiDrawLists[i].indexCount = 0;
+	}
+}
+
+// draw everything recorded since the last flush, one call per layer
+static void uiFlush()
+{
+	SDL_Texture* textures[UI_LAYER_COUNT] = { NULL, uiAtlas.texture };
+	
+	for(int i = 0; i < UI_LAYER_COUNT; ++i)
+	{
+		ui_draw_list_t* list = &uiDrawLists[i];
+		if(list->indexCount == 0)
+			continue;
+		
+		if(SDL_RenderGeometry(uiTarget, textures[i], list->vertices, list->vertexCount, list->indices, list->indexCount) != 0)
+			SDL_Log("Failed to draw ui:\n%s", SDL_GetError());
+		
+		list->vertexCount = 0;
+		list->indexCount = 0;
+	}
+}
+
+// draw what is left of the last window
+void uiEndFrame()
+{
+	uiFlush();
 }
 
 // push any number of lines
@@ -177,14 +393,17 @@ void uiSameLine(int n)
 // start a window fitting within the given rectangle
 int uiBeginWindow(SDL_Rect* rect, int* isActive)
 {
+	// windows declared earlier, text included, go underneath this one
+	uiFlush();
+	
 	uiTotalHeight = 0;
 	uiIndentLevel = 0;
 	memcpy(&uiCurrentWindow, rect, sizeof(SDL_Rect));
 	
 	if(*isActive)
 	{
-		SDL_SetRenderDrawColor(uiTarget, 20, 20, 20, 255);
-		SDL_RenderFillRect(uiTarget, rect);
+		SDL_Color background = {20, 20, 20, 255};
+		uiPushRect(rect, background);
 	}
 	
 	uiNextLineRect = uiCurrentWindow;
@@ -219,31 +438,36 @@ int uiInArea(SDL_Rect* r, int x, int y)
 	return (x >= x_min && x < x_max && y >= y_min && y < y_max);
 }
 
+// record one line of text clipped to the width of dstrect, with the font scaled to the line height
 void uiDrawText(const char* text, SDL_Rect dstrect, SDL_Color colour)
 {
-	int height = TTF_FontHeight(uiStyle.font);
-	double fontToLineHeight = (double)height/(double)uiSingleLineHeight;
-	
-	SDL_Rect srcrect = { 0, 0, dstrect.w * fontToLineHeight, dstrect.h * fontToLineHeight };
-	SDL_Surface* surface = TTF_RenderText_Solid_Wrapped(uiStyle.font, text, colour, srcrect.w);
+	if(uiAtlas.texture == NULL || uiAtlas.fontHeight <= 0)
+		return;
 	
-	dstrect.w = surface->w / fontToLineHeight;
+	float lineToFontHeight = (float)uiSingleLineHeight / (float)uiAtlas.fontHeight;
+	float x = dstrect.x, right = dstrect.x + dstrect.w;
 	
-	if(surface == NULL)
+	for(const char* c = text; *c != '\0' && x < right; ++c)
 	{
-		SDL_Log("Failed to render text to surface:\n%s", SDL_GetError());
-		return;
+		if(*c < UI_GLYPH_FIRST || *c > UI_GLYPH_LAST)
+			continue;
+		
+		ui_glyph_t* glyph = &uiAtlas.glyphs[*c - UI_GLYPH_FIRST];
+		SDL_FRect dst = { x, dstrect.y, glyph->rect.w * lineToFontHeight, glyph->rect.h * lineToFontHeight };
+		float u0 = (float)glyph->rect.x / uiAtlas.width, u1 = (float)(glyph->rect.x + glyph->rect.w) / uiAtlas.width;
+		float v0 = (float)glyph->rect.y / uiAtlas.height, v1 = (float)(glyph->rect.y + glyph->rect.h) / uiAtlas.height;
+		
+		// cut the last glyph at the edge of the rect rather than letting it spill over
+		if(dst.x + dst.w > right)
+		{
+			u1 = u0 + (u1 - u0) * (right - dst.x) / dst.w;
+			dst.w = right - dst.x;
+		}
+		
+		if(glyph->rect.w > 0)
+			uiPushQuad(UI_LAYER_TEXT, dst, colour, u0, v0, u1, v1);
+		x += glyph->advance * lineToFontHeight;
 	}
-	
-	SDL_Texture* tex = SDL_CreateTextureFromSurface(uiTarget, surface);
-	SDL_FreeSurface(surface);
-	
-	if(tex == NULL)
-		return;
-	
-	SDL_RenderCopy(uiTarget, tex, &srcrect, &dstrect);
-	
-	SDL_DestroyTexture(tex);
 }
 
 // draw an interactive slider with a min, max and step
@@ -304,13 +528,12 @@ int uiSlider(float* value, float min, float max, float step)
 		SLIDER_WIDTH, uiSingleLineHeight
 	};
 	
-	SDL_SetRenderDrawColor(uiTarget, 100, 100, 100, 255);
-	SDL_RenderFillRect(uiTarget, &lineRect);
+	SDL_Color lineColor = {100, 100, 100, 255};
+	uiPushRect(&lineRect, lineColor);
 	
 	if(valuePercentage >= 0 && valuePercentage <= 1)
 	{
-		SDL_SetRenderDrawColor(uiTarget, sliderColor.r, sliderColor.g, sliderColor.b, sliderColor.a);
-		SDL_RenderFillRect(uiTarget, &sliderRect);
+		uiPushRect(&sliderRect, sliderColor);
 	}
 	
 	uiNextLine();
@@ -333,8 +556,8 @@ int uiButton()
 		}
 	}
 	
-	SDL_SetRenderDrawColor(uiTarget, 100, 100, 100, 255);
-	SDL_RenderFillRect(uiTarget, &position);
+	SDL_Color buttonColor = {100, 100, 100, 255};
+	uiPushRect(&position, buttonColor);
 	
 	uiNextLine();
 
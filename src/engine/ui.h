@@ -19,7 +19,14 @@ extern void uiSetTarget(SDL_Renderer* renderer);
 extern void uiSetFont(TTF_Font* font);
 
 extern void uiBeginFrame();
-
+/**
+ * \brief Draws the widgets of the last window, batched into one SDL_RenderGeometry call for shapes and one for text.
+ */
+extern void uiEndFrame();
+
+/**
+ * \brief Draws the windows declared before this one, so each window covers the ones before it.
+ */
 extern int uiBeginWindow(SDL_Rect* rect, int* isActive);
 
 extern void uiSkipLines(int n);
@@ -62,6 +62,13 @@ static inline float vdist(fvec* a, fvec* b)
 	return isnan(m) ? 0 : m;
 }
 
+static inline float vsqrdist(fvec* a, fvec* b)
+{
+	fvec diff;
+	vsub(&diff, a, b);
+	return diff.x*diff.x + diff.y*diff.y;
+}
+
 static inline void vmovetowards(fvec* r, fvec* from, fvec* to, float max_delta)
 {
 	fvec diff, dir;
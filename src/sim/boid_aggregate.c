@@ -0,0 +1,330 @@
+//
+//  boid_aggregate.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "boid_aggregate.h"
+#include "boid_c.h"
+#include "boid_grid.h"
+#include <SDL2/SDL.h>
+#include <assert.h>
+
+// limits the number of finest cells to a multiple of the number of boids
+#define BOID_AGGREGATE_CELLS_PER_BOID (4)
+// steps between comparing approximated cohesion against the exact result
+#define BOID_AGGREGATE_CHECK_INTERVAL (30)
+// boids compared per check
+#define BOID_AGGREGATE_CHECK_SAMPLES (32)
+
+typedef struct boid_aggregate_query_t {
+	fvec centre;
+	float sqr_radius, sqr_theta;
+	fvec sum;
+	size_t count;
+	size_t visits; // cells taken whole plus boids tested one by one
+} boid_aggregate_query_t;
+
+boid_aggregate_t boid_aggregate;
+float boid_aggregate_theta = 0.f;
+float boid_aggregate_mean_error = 0.f;
+float boid_aggregate_max_error = 0.f;
+
+size_t boid_aggregate_cell_capacity[BOID_AGGREGATE_MAX_LEVELS];
+size_t boid_aggregate_start_capacity;
+size_t boid_aggregate_position_capacity;
+size_t* boid_aggregate_cells; // finest cell of each grid entry while building
+
+// accumulated by the periodic checks
+double boid_aggregate_total_error;
+size_t boid_aggregate_samples;
+size_t boid_aggregate_exact_visits, boid_aggregate_approx_visits;
+
+static inline int boid_aggregate_clamp(int v, int max)
+{
+	return v < 0 ? 0 : v >= max ? max - 1 : v;
+}
+
+static void boid_aggregate_build(float range)
+{
+	boid_aggregate_level_t* level, *below;
+	size_t count = boid_grid.count;
+	fvec extent = {
+		boid_grid.cells_w * boid_grid.cell_size,
+		boid_grid.cells_h * boid_grid.cell_size
+	};
+
+	// the coarsest level has cells about as large as the range, fewer levels when boids are sparse
+	float cell_size = range / (float)(1 << (BOID_AGGREGATE_MAX_LEVELS - 1));
+	size_t max_cells = count * BOID_AGGREGATE_CELLS_PER_BOID + 1;
+	int cells_w, cells_h;
+	do
+	{
+		cells_w = (int)(extent.x / cell_size) + 1;
+		cells_h = (int)(extent.y / cell_size) + 1;
+		if((size_t)cells_w * cells_h <= max_cells) break;
+		cell_size *= 2.f;
+	} while(1);
+
+	boid_aggregate.origin = boid_grid.origin;
+	boid_aggregate.count = count;
+	boid_aggregate.level_count = 0;
+
+	do
+	{
+		level = &boid_aggregate.levels[boid_aggregate.level_count];
+		level->cell_size = cell_size;
+		level->cells_w = cells_w;
+		level->cells_h = cells_h;
+
+		size_t cells = (size_t)cells_w * cells_h;
+		if(cells > boid_aggregate_cell_capacity[boid_aggregate.level_count])
+		{
+			level->cells = arenaRealloc(&boid_grid_arena, level->cells,
+										boid_aggregate_cell_capacity[boid_aggregate.level_count] * sizeof(boid_aggregate_cell_t),
+										cells * sizeof(boid_aggregate_cell_t));
+			boid_aggregate_cell_capacity[boid_aggregate.level_count] = cells;
+			assert(level->cells != NULL);
+		}
+		memset(level->cells, 0, cells * sizeof(boid_aggregate_cell_t));
+
+		++boid_aggregate.level_count;
+		cell_size *= 2.f;
+		cells_w = (cells_w + 1) / 2;
+		cells_h = (cells_h + 1) / 2;
+	} while(boid_aggregate.level_count < BOID_AGGREGATE_MAX_LEVELS && cell_size <= range);
+
+	if(count > boid_aggregate_position_capacity)
+	{
+		boid_aggregate.positions = arenaRealloc(&boid_grid_arena, boid_aggregate.positions,
+												boid_aggregate_position_capacity * sizeof(fvec), count * sizeof(fvec));
+		boid_aggregate_cells = arenaRealloc(&boid_grid_arena, boid_aggregate_cells,
+											boid_aggregate_position_capacity * sizeof(size_t), count * sizeof(size_t));
+		boid_aggregate_position_capacity = count;
+		assert(boid_aggregate.positions != NULL && boid_aggregate_cells != NULL);
+	}
+
+	level = &boid_aggregate.levels[0];
+	size_t cells = (size_t)level->cells_w * level->cells_h;
+	if(cells + 1 > boid_aggregate_start_capacity)
+	{
+		boid_aggregate.cell_start = arenaRealloc(&boid_grid_arena, boid_aggregate.cell_start,
+												 boid_aggregate_start_capacity * sizeof(size_t), (cells + 1) * sizeof(size_t));
+		boid_aggregate_start_capacity = cells + 1;
+		assert(boid_aggregate.cell_start != NULL);
+	}
+
+	// counting sort of the grid entries by finest cell, summing the cells on the way
+	memset(boid_aggregate.cell_start, 0, (cells + 1) * sizeof(size_t));
+	for(size_t i = 0; i < count; ++i)
+	{
+		fvec* position = &boid_grid.entries[i].position;
+		int x = boid_aggregate_clamp((int)floorf((position->x - boid_aggregate.origin.x) / level->cell_size), level->cells_w);
+		int y = boid_aggregate_clamp((int)floorf((position->y - boid_aggregate.origin.y) / level->cell_size), level->cells_h);
+		size_t cell = (size_t)y * level->cells_w + x;
+
+		boid_aggregate_cells[i] = cell;
+		++boid_aggregate.cell_start[cell];
+		vadd(&level->cells[cell].sum, &level->cells[cell].sum, position);
+		++level->cells[cell].count;
+	}
+
+	size_t start = 0, cell_count;
+	for(size_t i = 0; i < cells; ++i)
+	{
+		cell_count = boid_aggregate.cell_start[i];
+		boid_aggregate.cell_start[i] = start;
+		start += cell_count;
+	}
+
+	for(size_t i = 0; i < count; ++i)
+		boid_aggregate.positions[boid_aggregate.cell_start[boid_aggregate_cells[i]]++] = boid_grid.entries[i].position;
+
+	// every cell_start now holds the start of the next cell, shift them back into place
+	memmove(boid_aggregate.cell_start + 1, boid_aggregate.cell_start, cells * sizeof(size_t));
+	boid_aggregate.cell_start[0] = 0;
+
+	// every coarser cell sums the two by two cells below it
+	for(int l = 1; l < boid_aggregate.level_count; ++l)
+	{
+		level = &boid_aggregate.levels[l];
+		below = &boid_aggregate.levels[l - 1];
+		for(int y = 0; y < below->cells_h; ++y)
+		{
+			for(int x = 0; x < below->cells_w; ++x)
+			{
+				boid_aggregate_cell_t* child = &below->cells[(size_t)y * below->cells_w + x];
+				boid_aggregate_cell_t* parent = &level->cells[(size_t)(y >> 1) * level->cells_w + (x >> 1)];
+				vadd(&parent->sum, &parent->sum, &child->sum);
+				parent->count += child->count;
+			}
+		}
+	}
+}
+
+static inline void boid_aggregate_take(boid_aggregate_query_t* query, fvec* sum, size_t count)
+{
+	vadd(&query->sum, &query->sum, sum);
+	query->count += count;
+	++query->visits;
+}
+
+static void boid_aggregate_visit(boid_aggregate_query_t* query, int l, int x, int y)
+{
+	boid_aggregate_level_t* level = &boid_aggregate.levels[l];
+	boid_aggregate_cell_t* cell = &level->cells[(size_t)y * level->cells_w + x];
+	fvec* centre = &query->centre;
+
+	if(cell->count == 0) return;
+
+	float x0 = boid_aggregate.origin.x + (float)x * level->cell_size, x1 = x0 + level->cell_size;
+	float y0 = boid_aggregate.origin.y + (float)y * level->cell_size, y1 = y0 + level->cell_size;
+
+	// cells entirely out of range are skipped and cells entirely in range are exact as they are,
+	// boids that strayed past the grid and were clamped into its edge cells are the exception
+	float dx = fmaxf(fmaxf(x0 - centre->x, centre->x - x1), 0.f);
+	float dy = fmaxf(fmaxf(y0 - centre->y, centre->y - y1), 0.f);
+	if(dx * dx + dy * dy >= query->sqr_radius) return;
+
+	dx = fmaxf(centre->x - x0, x1 - centre->x);
+	dy = fmaxf(centre->y - y0, y1 - centre->y);
+	if(dx * dx + dy * dy < query->sqr_radius)
+	{
+		boid_aggregate_take(query, &cell->sum, cell->count);
+		return;
+	}
+
+	if(l > 0)
+	{
+		// a cell small against its distance counts as a single boid at its centre of mass
+		fvec mass_centre;
+		vmulf(&mass_centre, &cell->sum, 1.f / (float)cell->count);
+		float sqr_dist = vsqrdist(&mass_centre, centre);
+		if(level->cell_size * level->cell_size < query->sqr_theta * sqr_dist)
+		{
+			if(sqr_dist < query->sqr_radius)
+				boid_aggregate_take(query, &cell->sum, cell->count);
+			return;
+		}
+
+		boid_aggregate_level_t* below = &boid_aggregate.levels[l - 1];
+		for(int cy = y * 2; cy <= y * 2 + 1 && cy < below->cells_h; ++cy)
+			for(int cx = x * 2; cx <= x * 2 + 1 && cx < below->cells_w; ++cx)
+				boid_aggregate_visit(query, l - 1, cx, cy);
+		return;
+	}
+
+	size_t index = (size_t)y * level->cells_w + x;
+	fvec* end = boid_aggregate.positions + boid_aggregate.cell_start[index + 1];
+	for(fvec* position = boid_aggregate.positions + boid_aggregate.cell_start[index]; position < end; ++position)
+	{
+		++query->visits;
+		if(vsqrdist(position, centre) < query->sqr_radius)
+		{
+			vadd(&query->sum, &query->sum, position);
+			++query->count;
+		}
+	}
+}
+
+static void boid_aggregate_query(boid_aggregate_query_t* query, float radius)
+{
+	if(boid_aggregate.count == 0 || boid_aggregate.level_count == 0) return;
+
+	boid_aggregate_level_t* top = &boid_aggregate.levels[boid_aggregate.level_count - 1];
+	fvec* centre = &query->centre;
+	int x0 = boid_aggregate_clamp((int)floorf((centre->x - radius - boid_aggregate.origin.x) / top->cell_size), top->cells_w);
+	int x1 = boid_aggregate_clamp((int)floorf((centre->x + radius - boid_aggregate.origin.x) / top->cell_size), top->cells_w);
+	int y0 = boid_aggregate_clamp((int)floorf((centre->y - radius - boid_aggregate.origin.y) / top->cell_size), top->cells_h);
+	int y1 = boid_aggregate_clamp((int)floorf((centre->y + radius - boid_aggregate.origin.y) / top->cell_size), top->cells_h);
+
+	for(int y = y0; y <= y1; ++y)
+		for(int x = x0; x <= x1; ++x)
+			boid_aggregate_visit(query, boid_aggregate.level_count - 1, x, y);
+}
+
+size_t boid_aggregate_mean(fvec* centre, float radius, float theta, fvec* mean)
+{
+	boid_aggregate_query_t query = {
+		.centre = *centre,
+		.sqr_radius = radius * radius,
+		.sqr_theta = theta * theta
+	};
+
+	boid_aggregate_query(&query, radius);
+
+	if(query.count > 0)
+		vmulf(mean, &query.sum, 1.f / (float)query.count);
+	else
+		*mean = *centre;
+
+	return query.count;
+}
+
+// compares a spread of boids against a query that opens every straddling cell
+static void boid_aggregate_check(float radius, float theta)
+{
+	size_t stride = boid_aggregate.count / BOID_AGGREGATE_CHECK_SAMPLES + 1;
+	fvec exact_mean, approx_mean;
+
+	for(size_t i = 0; i < boid_aggregate.count; i += stride)
+	{
+		boid_aggregate_query_t exact = {
+			.centre = boid_aggregate.positions[i],
+			.sqr_radius = radius * radius
+		};
+		boid_aggregate_query_t approx = exact;
+		approx.sqr_theta = theta * theta;
+
+		boid_aggregate_query(&exact, radius);
+		boid_aggregate_query(&approx, radius);
+		if(exact.count == 0 || approx.count == 0) continue;
+
+		vmulf(&exact_mean, &exact.sum, 1.f / (float)exact.count);
+		vmulf(&approx_mean, &approx.sum, 1.f / (float)approx.count);
+		float error = vdist(&exact_mean, &approx_mean) / radius;
+
+		boid_aggregate_total_error += error;
+		boid_aggregate_max_error = fmaxf(boid_aggregate_max_error, error);
+		boid_aggregate_exact_visits += exact.visits;
+		boid_aggregate_approx_visits += approx.visits;
+		++boid_aggregate_samples;
+	}
+
+	if(boid_aggregate_samples > 0)
+		boid_aggregate_mean_error = (float)(boid_aggregate_total_error / (double)boid_aggregate_samples);
+}
+
+void boid_aggregate_report(void)
+{
+	if(boid_aggregate_samples == 0) return;
+
+	SDL_Log("cohesion aggregates: %.3f%% mean and %.3f%% max error of the range over %zu boids, "
+			"%.1f visits per boid against %.1f exact",
+			boid_aggregate_mean_error * 100.f, boid_aggregate_max_error * 100.f, boid_aggregate_samples,
+			(double)boid_aggregate_approx_visits / (double)boid_aggregate_samples,
+			(double)boid_aggregate_exact_visits / (double)boid_aggregate_samples);
+}
+
+void boid_aggregate_terminate(void)
+{
+	// the buffers live in boid_grid_arena and go with it
+	memset(&boid_aggregate, 0, sizeof(boid_aggregate_t));
+	memset(boid_aggregate_cell_capacity, 0, sizeof(boid_aggregate_cell_capacity));
+	boid_aggregate_start_capacity = boid_aggregate_position_capacity = 0;
+	boid_aggregate_cells = NULL;
+}
+
+// builds on the boid grid, so runs after system_boid_grid_build
+void system_boid_aggregate_build(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	static uint32_t steps = 0;
+
+	if(boid_aggregate.theta <= 0.f) return;
+
+	boid_aggregate_build(cohesion.range);
+
+	if(++steps % BOID_AGGREGATE_CHECK_INTERVAL == 0)
+		boid_aggregate_check(cohesion.range, boid_aggregate.theta);
+}
@@ -0,0 +1,66 @@
+//
+//  boid_aggregate.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef boid_aggregate_h
+#define boid_aggregate_h
+
+#include <ecs.h>
+#include <stdint.h>
+#include <vec.h>
+
+#define BOID_AGGREGATE_MAX_LEVELS (5)
+
+// number and summed position of the boids in a cell
+typedef struct boid_aggregate_cell_t {
+	fvec sum;
+	uint32_t count;
+} boid_aggregate_cell_t;
+
+typedef struct boid_aggregate_level_t {
+	float cell_size;
+	int cells_w, cells_h;
+	boid_aggregate_cell_t* cells;
+} boid_aggregate_level_t;
+
+// multi-level grid of cell aggregates, each level has cells twice the size of the one below,
+// rebuilt from the boid grid every step by system_boid_aggregate_build
+typedef struct boid_aggregate_t {
+	fvec origin;
+	int level_count;
+	boid_aggregate_level_t levels[BOID_AGGREGATE_MAX_LEVELS];
+	size_t* cell_start; // positions in finest cell i are [cell_start[i], cell_start[i+1])
+	fvec* positions;
+	size_t count;
+	float theta; // boid_aggregate_theta for the current step
+} boid_aggregate_t;
+
+extern boid_aggregate_t boid_aggregate;
+
+// cells that straddle the range and are smaller than theta times their distance count as a single point,
+// 0 computes cohesion exactly from the neighbour lists
+extern float boid_aggregate_theta;
+// mean and largest cohesion error of the sampled boids, relative to the cohesion range
+extern float boid_aggregate_mean_error;
+extern float boid_aggregate_max_error;
+
+/**
+ * \brief Averages the positions of the boids within radius of centre.
+ * \param theta The accuracy of the approximation, 0 visits every boid that straddling cells contain.
+ * \param mean Receives the mean position.
+ * \returns The number of boids the mean was taken over.
+ */
+extern size_t boid_aggregate_mean(fvec* centre, float radius, float theta, fvec* mean);
+
+/**
+ * \brief Logs the error of approximated cohesion against the exact result, and the work each saved.
+ */
+extern void boid_aggregate_report(void);
+extern void boid_aggregate_terminate(void);
+
+extern void system_boid_aggregate_build(ecsEntityId*, ecsComponentMask*, size_t, float);
+
+#endif /* boid_aggregate_h */
@@ -6,16 +6,50 @@
 //
 
 #include "boid_c.h"
+#include "boid_aggregate.h"
+#include "boid_domain.h"
+#include "boid_grid.h"
+#include "boid_snapshot.h"
+#include "obstacle.h"
 #include <SDL2/SDL.h>
 #include <engine.h>
+#include <cmd.h>
 #include <assert.h>
 
 ecsComponentMask boid_component;
+size_t boid_component_size;
 
 float boid_acceleration = 75.f;
 float boid_max_velocity = 50.f;
 
+// extra range added to neighbour lists so they can be reused across frames
+float boid_near_skin = 10.f;
+size_t boid_near_rebuilds = 0;
+
+// boids leaving boid_available_area come back in on the opposite side instead of being turned by its walls
+short boid_periodic = 0;
+
+// frames between re-sorting boid storage along a z-order curve, 0 disables periodic sorts
+int boid_sort_interval = 2000;
+// re-sort early once boid_locality grows past this multiple of its value after the last sort, or of its first measurement
+float boid_sort_threshold = 2.f;
+// mean distance between boids that are adjacent in memory
+float boid_locality = 0.f;
+// boid_locality before the last sort divided by boid_locality after it
+float boid_sort_gain = 1.f;
+
 SDL_Texture* boid_texture;
+SDL_Texture* boid_density_texture;
+
+// on-screen boids per pixel above which dense areas are drawn as a density map
+float boid_lod_density = 0.02f;
+// size in pixels of a density map cell
+int boid_lod_cell_size = 4;
+// cells holding at most this many boids still draw each boid
+int boid_lod_sparse_count = 2;
+
+// boids per second spawned at the cursor while the right mouse button is held
+float boid_spawn_rate = 200.f;
 
 behaviour_t alignment = {
 	.range = 10.f,
@@ -40,69 +74,207 @@ behaviour_t mouse_interact = {
 
 SDL_Rect boid_available_area = {0,0,800, 800};
 
-void system_boid_update_position(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+float boid_max_range(void)
 {
-	boid_c* boid;
-	fvec force, velocity;
-	float acceleration = boid_acceleration * delta_time;
-	int w, h;
+	float max_range = alignment.range;
+	max_range = separation.range > max_range ? separation.range : max_range;
+	// approximated cohesion reads the aggregates instead of the neighbour lists
+	if(boid_aggregate.theta <= 0.f)
+		max_range = cohesion.range > max_range ? cohesion.range : max_range;
+	return max_range;
+}
+
+// neighbours to keep per boid, fewer than BOID_NEAR_COUNT when every behaviour reading the lists is limited
+size_t boid_near_k(void)
+{
+	if(alignment.nearest <= 0 || separation.nearest <= 0 || (boid_aggregate.theta <= 0.f && cohesion.nearest <= 0))
+		return BOID_NEAR_COUNT;
 	
-	for(size_t i = 0; i < count; i++)
+	size_t k = behaviour_nearest(&alignment);
+	k = behaviour_nearest(&separation) > k ? behaviour_nearest(&separation) : k;
+	if(boid_aggregate.theta <= 0.f)
+		k = behaviour_nearest(&cohesion) > k ? behaviour_nearest(&cohesion) : k;
+	return k;
+}
+
+// index of the first entry of a sorted neighbour list at or beyond range
+static inline uint16_t boid_near_cut(boid_c* boid, size_t count, float range)
+{
+	float sqr_range = range * range;
+	size_t low = 0, high = count, middle;
+	
+	while(low < high)
 	{
-		boid = ecsGetComponentPtr(entities[i], boid_component);
-		
-		force = boid->force;
-		vmulf(&force, &force, boid_max_velocity);
-		vmax(&force, &force, boid_max_velocity);
-		vmovetowards(&boid->velocity, &boid->velocity, &force, acceleration);
-		
-		assert(!isnan(boid->position.x) && !isnan(boid->position.y));
-		assert(!isnan(boid->velocity.x) && !isnan(boid->velocity.y));
-		
-		boid->force = (fvec){ 0.f, 0.f };
-		
-		vmulf(&velocity, &boid->velocity, delta_time);
-		vadd(&boid->position, &boid->position, &velocity);
+		middle = (low + high) / 2;
+		if(boid->near_sqr_dist[middle] < sqr_range) low = middle + 1;
+		else high = middle;
+	}
+	return (uint16_t)low;
+}
+
+// brings the distances of a reused list up to date and finds where the range of each behaviour ends in it
+static void boid_near_refresh(boid_c* boid, short reused)
+{
+	boid_c* other;
+	ecsEntityId entity;
+	fvec position;
+	float sqr_dist;
+	size_t count = 0, j;
+	
+	while(count < BOID_NEAR_COUNT && boid->near[count] != noentity) ++count;
+	
+	if(reused)
+	{
+		for(j = 0; j < count; ++j)
+		{
+			other = ecsGetComponentPtr(boid->near[j], boid_component);
+			position = other->position;
+			if(boid_periodic) boid_nearest_image(&position, &boid->position);
+			boid->near_sqr_dist[j] = vsqrdist(&position, &boid->position);
+		}
 		
+		// insertion sort, as boids barely move between steps the list is close to sorted already
+		for(size_t i = 1; i < count; ++i)
+		{
+			entity = boid->near[i];
+			sqr_dist = boid->near_sqr_dist[i];
+			for(j = i; j > 0 && boid->near_sqr_dist[j - 1] > sqr_dist; --j)
+			{
+				boid->near[j] = boid->near[j - 1];
+				boid->near_sqr_dist[j] = boid->near_sqr_dist[j - 1];
+			}
+			boid->near[j] = entity;
+			boid->near_sqr_dist[j] = sqr_dist;
+		}
 	}
+	
+	boid->near_cut[BOID_NEAR_SEPARATION] = boid_near_cut(boid, count, separation.range);
+	boid->near_cut[BOID_NEAR_ALIGNMENT] = boid_near_cut(boid, count, alignment.range);
+	boid->near_cut[BOID_NEAR_COHESION] = boid_near_cut(boid, count, cohesion.range);
 }
 
 void system_boid_update_near(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
 {
-	float dist;
-	boid_c* boid, *other;
+	static float last_range = -1.f, last_skin = -1.f;
+	static size_t last_count = 0, last_k = 0;
+	static uint32_t last_generation = 0;
 	
-	float max_range = alignment.range;
-	max_range = separation.range > max_range ? separation.range : max_range;
-	max_range = cohesion.range > max_range ? cohesion.range : max_range;
+	boid_c* boid;
+	boid_grid_hit_t hits[BOID_NEAR_COUNT];
 	
-	size_t hits = 0;
+	float max_range = boid_max_range();
+	size_t k = boid_near_k(), hit_count;
+	short reuse = 0;
 	
+	// lists built with range + skin stay valid until some boid has moved more than half the skin,
+	// as two boids closing in on each other can then have covered the whole margin,
+	// lists cut down to the nearest few only approximately so,
+	// a skin changed since the last rebuild no longer matches the margin the lists were built with,
+	// and halo slots freed or handed to another boid since then may still be listed
+	if(boid_near_skin > 0.f && max_range == last_range && boid_near_skin == last_skin && count == last_count && k == last_k
+	   && boid_domain_generation == last_generation)
+	{
+		float max_displacement = 0.f, displacement;
+		float half_skin = boid_near_skin * 0.5f;
+		fvec origin;
+		
+		for(size_t i = 0; i < count; ++i)
+		{
+			boid = ecsGetComponentPtr(entities[i], boid_component);
+			// a boid wrapped across the seam has only moved as far as the copy of its origin nearest to it
+			origin = boid->near_origin;
+			if(boid_periodic) boid_nearest_image(&origin, &boid->position);
+			displacement = vsqrdist(&boid->position, &origin);
+			max_displacement = displacement > max_displacement ? displacement : max_displacement;
+		}
+		
+		reuse = max_displacement <= half_skin * half_skin;
+	}
+	
+	if(!reuse)
+	{
+		last_range = max_range;
+		last_skin = boid_near_skin;
+		last_count = count;
+		last_k = k;
+		last_generation = boid_domain_generation;
+		max_range += boid_near_skin;
+		++boid_near_rebuilds;
+	}
+	
+	// candidates come from the grid built by system_boid_grid_build earlier this frame
 	for(size_t i = 0; i < count; ++i)
 	{
 		boid = ecsGetComponentPtr(entities[i], boid_component);
-		hits = 0;
 		
-		memset(boid->near, noentity, sizeof(boid->near));
-		for(size_t j = 0; j < count && hits < BOID_NEAR_COUNT; ++j)
+		if(!reuse)
 		{
-			other = ecsGetComponentPtr(entities[j], boid_component);
-			dist = vdist(&boid->position, &other->position);
+			boid->near_origin = boid->position;
+			memset(boid->near, noentity, sizeof(boid->near));
 			
-			assert(!isnan(dist));
-			if(dist < max_range)
+			// the k nearest, sorted by distance, the cost per boid is bounded by k however dense the flock gets
+			hit_count = boid->ownership == BOID_OWNED ? boid_grid_query_nearest(&boid->position, max_range, hits, k) : 0;
+			for(size_t j = 0; j < hit_count; ++j)
 			{
-				boid->near[hits++] = entities[j];
+				boid->near[j] = hits[j].entity;
+				boid->near_sqr_dist[j] = hits[j].sqr_dist;
 			}
 		}
+		
+		boid_near_refresh(boid, reuse);
 	}
 }
 
-void system_draw_boids(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+// screen cell index of a position, or -1 when off screen
+static inline long boid_lod_cell_index(fvec* position, int cells_w, int cells_h)
 {
-	if(!is_render_frame) return;
+	if(position->x < 0.f || position->y < 0.f) return -1;
+	int cx = (int)position->x / boid_lod_cell_size;
+	int cy = (int)position->y / boid_lod_cell_size;
+	if(cx >= cells_w || cy >= cells_h) return -1;
+	return (long)cy * cells_w + cx;
+}
+
+uint32_t boid_lod_color(uint32_t count, float scale)
+{
+	if(count <= (uint32_t)boid_lod_sparse_count)
+		return 0;
 	
-	boid_c* boid;
+	// log scale so that both loose and packed flocks stay readable
+	float t = log2f(1.f + (float)count) * scale;
+	uint32_t alpha = 96 + (uint32_t)(159.f * t);
+	uint32_t blue = 255, green = (uint32_t)(255.f * t), red = (uint32_t)(255.f * t * t);
+	return (alpha << 24) | (red << 16) | (green << 8) | blue;
+}
+
+// fill the density texture with dense cells, leaving sparse cells transparent
+static void boid_lod_update_texture(uint32_t* cell_counts, int cells_w, int cells_h, uint32_t max_count)
+{
+	uint32_t* pixels;
+	int pitch;
+	float scale = boid_lod_scale(max_count);
+	
+	if(SDL_LockTexture(boid_density_texture, NULL, (void**)&pixels, &pitch) != 0)
+		return;
+	
+	for(int y = 0; y < cells_h; ++y)
+	{
+		uint32_t* row = (uint32_t*)((char*)pixels + (size_t)y * pitch);
+		for(int x = 0; x < cells_w; ++x)
+			row[x] = boid_lod_color(cell_counts[(size_t)y * cells_w + x], scale);
+	}
+	
+	SDL_UnlockTexture(boid_density_texture);
+}
+
+void draw_boids(boid_snapshot_t* snapshot)
+{
+	static uint32_t* cell_counts = NULL;
+	static size_t cell_capacity = 0;
+	static int texture_w = 0, texture_h = 0;
+	
+	fvec* position;
+	long cell;
 	
 	int tw, th;
 	SDL_QueryTexture(boid_texture, NULL, NULL, &tw, &th);
@@ -116,138 +288,134 @@ void system_draw_boids(ecsEntityId* entities, ecsComponentMask* components, size
 	int hw = dstrect.w / 2;
 	int hh = dstrect.h / 2;
 	
-	for(size_t i = 0; i < count; ++i)
+	// bin boids into screen cells to find out how densely they cover the screen
+	int ww, wh;
+	SDL_GetRendererOutputSize(renderer, &ww, &wh);
+	int cells_w = (ww + boid_lod_cell_size - 1) / boid_lod_cell_size;
+	int cells_h = (wh + boid_lod_cell_size - 1) / boid_lod_cell_size;
+	size_t cell_count = (size_t)cells_w * cells_h;
+	size_t on_screen = 0;
+	uint32_t max_count = 0;
+	
+	if(cell_count > cell_capacity)
 	{
-		boid = ecsGetComponentPtr(entities[i], boid_component);
-		
-		dstrect.x = boid->position.x - hw;
-		dstrect.y = boid->position.y - hh;
-		SDL_RenderCopyExF(renderer, boid_texture,
-						  &srcrect, &dstrect,
-						  (double)vang(&boid->velocity, &VDOWN) * 57.2957795,
-						  &(SDL_FPoint){hw,hh}, SDL_FLIP_NONE);
+		cell_capacity = cell_count;
+		cell_counts = realloc(cell_counts, cell_capacity * sizeof(uint32_t));
+		assert(cell_counts != NULL);
 	}
-}
-
-void system_boids_cohesion(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
-{
-	boid_c* boid, *other;
-	fvec avrg, force, diff;
-	float dist;
-	size_t hit_count;
+	memset(cell_counts, 0, cell_count * sizeof(uint32_t));
 	
-	for(size_t i = 0; i < count; ++i)
+	for(size_t i = 0; i < snapshot->count; ++i)
 	{
-		boid = ecsGetComponentPtr(entities[i], boid_component);
-		avrg = (fvec){ 0.f, 0.f };
-		hit_count = 0;
+		if((cell = boid_lod_cell_index(&snapshot->position[i], cells_w, cells_h)) < 0) continue;
 		
-		for(size_t j = 0; j < BOID_NEAR_COUNT && boid->near[j] != noentity; ++j)
+		++on_screen;
+		if(++cell_counts[cell] > max_count)
+			max_count = cell_counts[cell];
+	}
+	
+	// past the density threshold dense cells are shaded from a texture and only sparse cells get sprites
+	short use_lod = (float)on_screen > boid_lod_density * (float)ww * (float)wh;
+	
+	if(use_lod)
+	{
+		if(boid_density_texture == NULL || texture_w != cells_w || texture_h != cells_h)
 		{
-			other = ecsGetComponentPtr(boid->near[j], boid_component);
-			dist = vdist(&other->position, &boid->position);
-			if(dist < cohesion.range)
-			{
-				++hit_count;
-				vsub(&diff, &other->position, &avrg);
-				vmulf(&diff, &diff, 1.f/(hit_count));
-				vadd(&avrg, &avrg, &diff);
-			}
-			assert(!isnan(avrg.x) && !isnan(avrg.y));
+			if(boid_density_texture != NULL)
+				SDL_DestroyTexture(boid_density_texture);
+			boid_density_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+													 SDL_TEXTUREACCESS_STREAMING, cells_w, cells_h);
+			SDL_SetTextureBlendMode(boid_density_texture, SDL_BLENDMODE_BLEND);
+			texture_w = cells_w;
+			texture_h = cells_h;
 		}
 		
-		vsub(&force, &avrg, &boid->position);
-		vmulf(&force, &force, cohesion.force);
-		vadd(&boid->force, &boid->force, &force);
-		
-		assert(!isnan(boid->force.x) && !isnan(boid->force.y));
+		if(boid_density_texture != NULL)
+		{
+			boid_lod_update_texture(cell_counts, cells_w, cells_h, max_count);
+			SDL_RenderCopyF(renderer, boid_density_texture, NULL, &(SDL_FRect){
+				0.f, 0.f, (float)(cells_w * boid_lod_cell_size), (float)(cells_h * boid_lod_cell_size)
+			});
+		}
+		else
+		{
+			use_lod = 0;
+		}
 	}
-}
-
-void system_boids_separation(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
-{
-	boid_c* boid, *other;
-	fvec avrg, force, diff;
-	float dist;
-	size_t hit_count;
 	
-	for(size_t i = 0; i < count; ++i)
+	for(size_t i = 0; i < snapshot->count; ++i)
 	{
-		boid = ecsGetComponentPtr(entities[i], boid_component);
-		avrg = (fvec){ 0.f, 0.f };
-		hit_count = 0;
+		position = &snapshot->position[i];
 		
-		for(size_t j = 0; j < BOID_NEAR_COUNT && boid->near[j] != noentity; ++j)
+		if(use_lod)
 		{
-			other = ecsGetComponentPtr(boid->near[j], boid_component);
-			dist = vdist(&other->position, &boid->position);
-			if(dist < separation.range)
-			{
-				++hit_count;
-				vsub(&diff, &other->position, &avrg);
-				vmulf(&diff, &diff, 1.f/(hit_count));
-				vadd(&avrg, &avrg, &diff);
-			}
-			assert(!isnan(avrg.x) && !isnan(avrg.y));
+			cell = boid_lod_cell_index(position, cells_w, cells_h);
+			if(cell < 0 || cell_counts[cell] > (uint32_t)boid_lod_sparse_count) continue;
 		}
 		
-		vsub(&force, &avrg, &boid->position);
-		vmulf(&force, &force, separation.force);
-		vsub(&boid->force, &boid->force, &force);
-		assert(!isnan(boid->force.x) && !isnan(boid->force.y));
+		dstrect.x = position->x - hw;
+		dstrect.y = position->y - hh;
+		SDL_RenderCopyExF(renderer, boid_texture,
+						  &srcrect, &dstrect,
+						  (double)vang(&snapshot->velocity[i], &VDOWN) * 57.2957795,
+						  &(SDL_FPoint){hw,hh}, SDL_FLIP_NONE);
 	}
 }
 
-void system_boids_alignment(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+// new boids are recorded to the command buffer and created once the step is done
+static void boid_spawn_at(fvec* position, float delta_time)
 {
-	boid_c* boid, *other;
-	fvec avrg, diff;
-	float dist;
-	size_t hit_count;
+	static float pending = 0.f;
+	static uint64_t spawned = 0;
+	boid_c* boid;
 	
-	for(size_t i = 0; i < count; ++i)
+	for(pending += boid_spawn_rate * delta_time; pending >= 1.f; pending -= 1.f)
 	{
-		boid = ecsGetComponentPtr(entities[i], boid_component);
-		avrg = (fvec){ 0.f, 0.f };
-		hit_count = 0;
-		
-		for(size_t j = 0; j < BOID_NEAR_COUNT && boid->near[j] != noentity; ++j)
-		{
-			other = ecsGetComponentPtr(boid->near[j], boid_component);
-			dist = vdist(&other->position, &boid->position);
-			
-			if(dist < alignment.range)
-			{
-				++hit_count;
-				vsub(&diff, &other->velocity, &avrg);
-				vmulf(&diff, &diff, 1.f/(hit_count));
-				vadd(&avrg, &avrg, &diff);
-			}
-			assert(!isnan(avrg.x) && !isnan(avrg.y));
-		}
+		boid = cmdCreateEntity(spawned++, boid_component, boid_component, sizeof(boid_c));
+		if(boid == NULL) break;
 		
-		vmulf(&avrg, &avrg, alignment.force);
-		vadd(&boid->force, &boid->force, &avrg);
-		assert(!isnan(boid->force.x) && !isnan(boid->force.y));
+		// spread out a little so separation can act on them
+		(*boid) = (boid_c){
+			.position = {
+				position->x + (float)(rand() % 11 - 5),
+				position->y + (float)(rand() % 11 - 5)
+			},
+			.uid = boid_domain_make_uid(),
+			.ownership = BOID_OWNED
+		};
 	}
 }
 
+// only boids the grid finds within range of the cursor are visited
 void system_boid_mouse(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
 {
+	static ecsEntityId* hits = NULL;
+	static size_t hits_capacity = 0;
+	
 	boid_c* boid;
 	fvec mouse, diff;
 	float m;
 	int imx, imy;
-	uint32_t mstate = SDL_GetMouseState(&imx, &imy);
+	uint32_t mstate = engine_mouse_state(&imx, &imy);
 	mouse = (fvec){ (float)imx, (float)imy };
+	if((mstate & SDL_BUTTON_RMASK) != 0) boid_spawn_at(&mouse, delta_time);
 	if((mstate & SDL_BUTTON_LEFT) == 0) return;
 	
-	for(size_t i = 0; i < count; ++i)
+	if(boid_grid.count > hits_capacity)
 	{
-		boid = ecsGetComponentPtr(entities[i], boid_component);
+		hits_capacity = boid_grid.count;
+		hits = realloc(hits, hits_capacity * sizeof(ecsEntityId));
+		assert(hits != NULL);
+	}
+	
+	size_t hit_count = boid_grid_query_radius(&mouse, mouse_interact.range, hits, hits_capacity);
+	
+	for(size_t i = 0; i < hit_count; ++i)
+	{
+		boid = ecsGetComponentPtr(hits[i], boid_component);
 		vsub(&diff, &mouse, &boid->position);
 		m = vmag(&diff);
-		if(m < mouse_interact.range)
+		if(m > 0.f)
 		{
 			vmulf(&diff, &diff, (1.f/m)*mouse_interact.force);
 			vadd(&boid->force, &boid->force, &diff);
@@ -255,53 +423,186 @@ void system_boid_mouse(ecsEntityId* entities, ecsComponentMask* components, size
 	}
 }
 
+// keeps positions within boid_available_area, running before the grid so ghost cells see final positions
 void system_boids_wrap(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
 {
 	boid_c* boid;
-	int iw, ih;
-	float w, h;
-	SDL_GetRendererOutputSize(renderer, &iw, &ih);
-	w = (float)iw; h = (float)ih;
+	float x = (float)boid_available_area.x, y = (float)boid_available_area.y;
+	float w = (float)boid_available_area.w, h = (float)boid_available_area.h;
+	
+	if(!boid_periodic || w <= 0.f || h <= 0.f) return;
 	
 	for(size_t i = 0; i < count; ++i)
 	{
 		boid = ecsGetComponentPtr(entities[i], boid_component);
-		if(boid->position.x >= w) boid->position.x -= w;
-		if(boid->position.x < 0) boid->position.x += w;
-		if(boid->position.y >= h) boid->position.y -= h;
-		if(boid->position.y < 0) boid->position.y += w;
+		if(boid->ownership != BOID_OWNED) continue;
+		
+		// floor rather than a single add or subtract also brings back boids that were more than an area out
+		boid->position.x -= w * floorf((boid->position.x - x) / w);
+		boid->position.y -= h * floorf((boid->position.y - y) / h);
+		// rounding can land exactly on the far edge
+		if(boid->position.x >= x + w) boid->position.x = x;
+		if(boid->position.y >= y + h) boid->position.y = y;
+	}
+}
+
+typedef struct boid_sort_key_t {
+	uint32_t key;
+	size_t index;
+} boid_sort_key_t;
+
+// the fields a sort moves between slots, neighbour lists are rebuilt rather than carried along
+typedef struct boid_sort_copy_t {
+	fvec position;
+	fvec velocity;
+	fvec force;
+	uint64_t uid;
+	uint32_t halo_step;
+	uint8_t ownership;
+} boid_sort_copy_t;
+
+// interleave the lower 16 bits of v with zeroes
+static inline uint32_t morton_spread(uint32_t v)
+{
+	v &= 0x0000FFFF;
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+static int compare_sort_keys(const void* a, const void* b)
+{
+	const boid_sort_key_t* l = a, *r = b;
+	if(l->key != r->key)
+		return l->key < r->key ? -1 : 1;
+	return l->index < r->index ? -1 : (l->index > r->index);
+}
+
+static int compare_slots(const void* a, const void* b)
+{
+	uintptr_t l = (uintptr_t)*(boid_c* const*)a, r = (uintptr_t)*(boid_c* const*)b;
+	return l < r ? -1 : (l > r);
+}
+
+// fills slots with the components of entities in the order they sit in memory,
+// which is entity order when the ecs lays storage out that way and costs a sort when it does not
+static void boid_storage_slots(ecsEntityId* entities, size_t count, boid_c** slots)
+{
+	short ordered = 1;
+	
+	for(size_t i = 0; i < count; ++i)
+	{
+		slots[i] = ecsGetComponentPtr(entities[i], boid_component);
+		ordered = ordered && (i == 0 || (uintptr_t)slots[i] > (uintptr_t)slots[i - 1]);
 	}
+	
+	if(!ordered)
+		qsort(slots, count, sizeof(boid_c*), &compare_slots);
 }
 
-void system_boids_wall_avoid(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+// mean distance between boids that are next to each other in memory
+static float boid_storage_locality(boid_c** slots, size_t count)
 {
-	if(wall_avoid.force == 0.f) return;
+	float total = 0.f;
 	
-	boid_c* boid;
-	fvec force;
+	if(count < 2) return 0.f;
+	
+	for(size_t i = 1; i < count; ++i)
+		total += vdist(&slots[i]->position, &slots[i - 1]->position);
+	
+	return total / (float)(count - 1);
+}
 
-	SDL_Rect limits = boid_available_area;
-	limits.x += wall_avoid.range;
-	limits.w -= wall_avoid.range*2;
-	limits.y += wall_avoid.range;
-	limits.h -= wall_avoid.range*2;
+// Reorders boid data along a z-order curve so that boids near each other in space are near each other in memory.
+// Data is moved between the existing slots in address order rather than moving entities,
+// so the boid an entity holds changes and every neighbour list is rebuilt on the next update_near.
+void system_boids_sort(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	static size_t frames_since_sort = 0;
+	static float sorted_locality = 0.f;
+	static size_t capacity = 0;
+	static boid_sort_key_t* keys = NULL;
+	static boid_sort_copy_t* copies = NULL;
+	static boid_c** slots = NULL;
+	
+	boid_c* boid;
+	
+	if(count < 2) return;
 	
+	if(count > capacity)
+	{
+		capacity = count;
+		keys = realloc(keys, capacity * sizeof(boid_sort_key_t));
+		copies = realloc(copies, capacity * sizeof(boid_sort_copy_t));
+		slots = realloc(slots, capacity * sizeof(boid_c*));
+		assert(keys != NULL && copies != NULL && slots != NULL);
+	}
+	
+	++frames_since_sort;
+	boid_storage_slots(entities, count, slots);
+	boid_locality = boid_storage_locality(slots, count);
+	
+	// the first measurement is the reference later ones are held to
+	if(sorted_locality == 0.f)
+		sorted_locality = boid_locality;
+	
+	short sort_due = boid_sort_interval > 0 && frames_since_sort >= (size_t)boid_sort_interval;
+	short degraded = boid_sort_threshold > 0.f && boid_locality > sorted_locality * boid_sort_threshold;
+	
+	if(!sort_due && !degraded) return;
+	
+	// quantize positions to 16 bits per axis within their bounding box
+	fvec min = {INFINITY, INFINITY}, max = {-INFINITY, -INFINITY};
 	for(size_t i = 0; i < count; ++i)
 	{
-		boid = ecsGetComponentPtr(entities[i], boid_component);
-		force = (fvec){ 0.f, 0.f };
-		
-		if(boid->position.x >= limits.x + limits.w)
-			force.x = -1.f;
-		if(boid->position.x <= limits.x)
-			force.x = 1.f;
-		if(boid->position.y >= limits.y + limits.h)
-			force.y = -1.f;
-		if(boid->position.y <= limits.y)
-			force.y = 1.f;
-		
-		vnor(&force, &force);
-		vmulf(&force, &force, wall_avoid.force);
-		vadd(&boid->force, &boid->force, &force);
+		boid = slots[i];
+		copies[i] = (boid_sort_copy_t){
+			.position = boid->position,
+			.velocity = boid->velocity,
+			.force = boid->force,
+			.uid = boid->uid,
+			.halo_step = boid->halo_step,
+			.ownership = boid->ownership
+		};
+		min.x = fminf(min.x, boid->position.x); min.y = fminf(min.y, boid->position.y);
+		max.x = fmaxf(max.x, boid->position.x); max.y = fmaxf(max.y, boid->position.y);
 	}
+	
+	float scale_x = max.x > min.x ? 65535.f / (max.x - min.x) : 0.f;
+	float scale_y = max.y > min.y ? 65535.f / (max.y - min.y) : 0.f;
+	
+	for(size_t i = 0; i < count; ++i)
+	{
+		uint32_t qx = (uint32_t)((copies[i].position.x - min.x) * scale_x);
+		uint32_t qy = (uint32_t)((copies[i].position.y - min.y) * scale_y);
+		keys[i] = (boid_sort_key_t){
+			.key = morton_spread(qx) | (morton_spread(qy) << 1),
+			.index = i
+		};
+	}
+	
+	qsort(keys, count, sizeof(boid_sort_key_t), &compare_sort_keys);
+	
+	// the i-th boid along the curve goes to the i-th slot in memory
+	for(size_t i = 0; i < count; ++i)
+	{
+		boid_sort_copy_t* copy = &copies[keys[i].index];
+		boid = slots[i];
+		boid->position = copy->position;
+		boid->velocity = copy->velocity;
+		boid->force = copy->force;
+		boid->uid = copy->uid;
+		boid->halo_step = copy->halo_step;
+		boid->ownership = copy->ownership;
+		// entity ids in every list now name other boids, an infinite displacement forces a rebuild
+		boid->near_origin = (fvec){ INFINITY, INFINITY };
+		boid->near[0] = noentity;
+	}
+	
+	sorted_locality = boid_storage_locality(slots, count);
+	boid_sort_gain = sorted_locality > 0.f ? boid_locality / sorted_locality : 1.f;
+	boid_locality = sorted_locality;
+	frames_since_sort = 0;
 }
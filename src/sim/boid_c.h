@@ -11,34 +11,110 @@
 #include <ecs.h>
 #include <stdint.h>
 #include <vec.h>
+#include <SDL2/SDL_rect.h>
 
-#ifndef BOID_NEAR_COUNT
-#define BOID_NEAR_COUNT (100)
+// the same in every translation unit, the layout of boid_c depends on it
+#ifdef BOID_NEAR_COUNT
+#error "BOID_NEAR_COUNT is fixed by boid_c.h, changing it in one file would give that file a different boid_c"
 #endif
+#define BOID_NEAR_COUNT (100)
+
+typedef enum boid_ownership_t {
+	BOID_OWNED = 0x0, // simulated by this process
+	BOID_HALO, // copy of a boid owned by a neighbouring process
+	BOID_IDLE, // unused halo slot waiting to be reused
+} boid_ownership_t;
+
+// where the range of a behaviour ends in a neighbour list
+typedef enum boid_near_cut_t {
+	BOID_NEAR_SEPARATION = 0,
+	BOID_NEAR_ALIGNMENT,
+	BOID_NEAR_COHESION,
+	BOID_NEAR_CUTS
+} boid_near_cut_t;
 
 extern ecsComponentMask boid_component;
+// the size boid_c was registered with
+extern size_t boid_component_size;
 typedef struct boid_c {
 	fvec position;
 	fvec velocity;
 	fvec force;
+	fvec near_origin; // position when near was last rebuilt
+	uint64_t uid; // identifies the boid across processes
+	uint32_t halo_step; // last domain step this halo copy was refreshed
+	uint8_t ownership;
+	uint16_t near_cut[BOID_NEAR_CUTS]; // neighbours within the range of each behaviour are [0, near_cut)
+	// neighbours nearest first, with their squared distance as of this step
 	ecsEntityId near[BOID_NEAR_COUNT];
+	float near_sqr_dist[BOID_NEAR_COUNT];
 } boid_c;
 
 typedef struct behaviour_t {
 	float force;
 	float range;
+	int nearest; // most neighbours considered, nearest first, 0 considers every neighbour in range
 } behaviour_t;
 
 extern struct SDL_Texture* boid_texture;
+extern struct SDL_Texture* boid_density_texture;
+extern float boid_lod_density;
+extern int boid_lod_cell_size;
+extern int boid_lod_sparse_count;
+extern float boid_spawn_rate;
 extern float boid_acceleration;
 extern float boid_max_velocity;
+extern float boid_near_skin;
+extern short boid_periodic;
+extern size_t boid_near_rebuilds;
+extern int boid_sort_interval;
+extern float boid_sort_threshold;
+extern float boid_locality;
+extern float boid_sort_gain;
 
 extern behaviour_t alignment;
 extern behaviour_t separation;
 extern behaviour_t cohesion;
 extern behaviour_t wall_avoid;
 extern behaviour_t mouse_interact;
-extern struct SDL_Rect boid_available_area;
+extern SDL_Rect boid_available_area;
+
+/**
+ * \brief Colour of a density map cell holding count boids, transparent for cells sparse enough to draw each boid.
+ * \param scale boid_lod_scale of the densest cell.
+ */
+extern uint32_t boid_lod_color(uint32_t count, float scale);
+
+static inline float boid_lod_scale(uint32_t max_count)
+{
+	return 1.f / log2f(1.f + (float)max_count);
+}
+
+extern float boid_max_range(void);
+extern size_t boid_near_k(void);
+
+// the number of entries of a neighbour list a behaviour reads
+static inline size_t behaviour_nearest(behaviour_t* behaviour)
+{
+	return behaviour->nearest > 0 && behaviour->nearest < BOID_NEAR_COUNT ? (size_t)behaviour->nearest : BOID_NEAR_COUNT;
+}
+
+// moves position to its copy nearest to reference when the world wraps around
+static inline void boid_nearest_image(fvec* position, const fvec* reference)
+{
+	float w = (float)boid_available_area.w, h = (float)boid_available_area.h;
+	
+	if(position->x - reference->x > w * .5f) position->x -= w;
+	else if(reference->x - position->x > w * .5f) position->x += w;
+	if(position->y - reference->y > h * .5f) position->y -= h;
+	else if(reference->y - position->y > h * .5f) position->y += h;
+}
+
+struct boid_snapshot_t;
+/**
+ * \brief Draws the boids in a snapshot, call from the render thread.
+ */
+extern void draw_boids(struct boid_snapshot_t* snapshot);
 
 extern void system_boid_update_position(ecsEntityId*, ecsComponentMask*, size_t, float);
 extern void system_boids_cohesion(ecsEntityId*, ecsComponentMask*, size_t, float);
@@ -46,8 +122,8 @@ extern void system_boids_separation(ecsEntityId*, ecsComponentMask*, size_t, flo
 extern void system_boids_alignment(ecsEntityId*, ecsComponentMask*, size_t, float);
 extern void system_boids_wall_avoid(ecsEntityId*, ecsComponentMask*, size_t, float);
 extern void system_boids_wrap(ecsEntityId*, ecsComponentMask*, size_t, float);
-extern void system_draw_boids(ecsEntityId*, ecsComponentMask*, size_t, float);
 extern void system_boid_mouse(ecsEntityId*, ecsComponentMask*, size_t, float);
 extern void system_boid_update_near(ecsEntityId*, ecsComponentMask*, size_t, float);
+extern void system_boids_sort(ecsEntityId*, ecsComponentMask*, size_t, float);
 
 #endif /* boid_c_h */
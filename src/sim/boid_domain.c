@@ -0,0 +1,465 @@
+//
+//  boid_domain.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "boid_domain.h"
+#include "boid_c.h"
+#include <SDL2/SDL.h>
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define DOMAIN_CONNECT_ATTEMPTS (600)
+#define DOMAIN_CONNECT_DELAY_MS (50)
+
+typedef struct domain_record_t {
+	uint64_t uid;
+	fvec position;
+	fvec velocity;
+} domain_record_t;
+
+typedef struct domain_header_t {
+	uint32_t halo_count;
+	uint32_t migrant_count;
+} domain_header_t;
+
+typedef struct domain_records_t {
+	domain_record_t* first;
+	size_t count, capacity;
+} domain_records_t;
+
+typedef struct domain_link_t {
+	int fd;
+	domain_records_t halo, migrants, received;
+	domain_header_t received_header;
+} domain_link_t;
+
+typedef struct domain_ghost_t {
+	uint64_t uid;
+	ecsEntityId entity;
+} domain_ghost_t;
+
+enum {
+	DOMAIN_LEFT = 0,
+	DOMAIN_RIGHT = 1,
+	DOMAIN_SIDES
+};
+
+int boid_domain_rank = 0;
+int boid_domain_count = 1;
+uint32_t boid_domain_step = 0;
+uint32_t boid_domain_generation = 0;
+
+float domain_min_x;
+float domain_strip_width;
+uint64_t domain_next_uid;
+domain_link_t domain_links[DOMAIN_SIDES];
+
+domain_ghost_t* domain_ghosts;
+size_t domain_ghost_count, domain_ghost_capacity;
+ecsEntityId* domain_idle;
+size_t domain_idle_count, domain_idle_capacity;
+
+static void domain_push_record(domain_records_t* records, boid_c* boid);
+static int domain_exchange(domain_link_t* link, int send_first);
+
+
+//
+// SETUP
+//
+
+static void domain_socket_path(char* out, size_t size, const char* socket_dir, int rank)
+{
+	snprintf(out, size, "%s/boids-domain-%d.sock", socket_dir, rank);
+}
+
+static int domain_connect(const char* socket_dir, int rank)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	domain_socket_path(addr.sun_path, sizeof(addr.sun_path), socket_dir, rank);
+
+	for(int attempt = 0; attempt < DOMAIN_CONNECT_ATTEMPTS; ++attempt)
+	{
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(fd < 0)
+			return -1;
+		if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+			return fd;
+		close(fd);
+		// the neighbour may not be listening yet
+		SDL_Delay(DOMAIN_CONNECT_DELAY_MS);
+	}
+
+	return -1;
+}
+
+int boid_domain_init(int rank, int count, const char* socket_dir, SDL_Rect* area)
+{
+	assert(count > 0 && rank >= 0 && rank < count);
+
+	boid_domain_rank = rank;
+	boid_domain_count = count;
+	boid_domain_step = 0;
+	domain_min_x = area->x;
+	domain_strip_width = (float)area->w / (float)count;
+	domain_next_uid = 0;
+
+	memset(domain_links, 0, sizeof(domain_links));
+	domain_links[DOMAIN_LEFT].fd = domain_links[DOMAIN_RIGHT].fd = -1;
+
+	if(count == 1)
+		return 0;
+
+	int listen_fd = -1;
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	domain_socket_path(addr.sun_path, sizeof(addr.sun_path), socket_dir, rank);
+
+	// listen for the right neighbour before connecting to the left one, so that every rank can make progress
+	if(rank < count - 1)
+	{
+		unlink(addr.sun_path);
+		listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(listen_fd < 0
+		   || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0
+		   || listen(listen_fd, 1) != 0)
+		{
+			SDL_Log("Failed to listen on %s", addr.sun_path);
+			goto fail;
+		}
+	}
+
+	if(rank > 0 && (domain_links[DOMAIN_LEFT].fd = domain_connect(socket_dir, rank - 1)) < 0)
+	{
+		SDL_Log("Failed to connect to domain %d", rank - 1);
+		goto fail;
+	}
+
+	if(rank < count - 1)
+	{
+		if((domain_links[DOMAIN_RIGHT].fd = accept(listen_fd, NULL, NULL)) < 0)
+		{
+			SDL_Log("Failed to accept domain %d", rank + 1);
+			goto fail;
+		}
+		close(listen_fd);
+		unlink(addr.sun_path);
+	}
+
+	return 0;
+
+fail:
+	if(listen_fd >= 0)
+	{
+		close(listen_fd);
+		unlink(addr.sun_path);
+	}
+	boid_domain_quit();
+	return -1;
+}
+
+void boid_domain_quit(void)
+{
+	for(int side = 0; side < DOMAIN_SIDES; ++side)
+	{
+		domain_link_t* link = &domain_links[side];
+		if(link->fd >= 0)
+			close(link->fd);
+		free(link->halo.first);
+		free(link->migrants.first);
+		free(link->received.first);
+		memset(link, 0, sizeof(domain_link_t));
+		link->fd = -1;
+	}
+
+	free(domain_ghosts);
+	free(domain_idle);
+	domain_ghosts = NULL;
+	domain_idle = NULL;
+	domain_ghost_count = domain_ghost_capacity = 0;
+	domain_idle_count = domain_idle_capacity = 0;
+
+	boid_domain_rank = 0;
+	boid_domain_count = 1;
+}
+
+void boid_domain_strip(int rank, float* min_x, float* max_x)
+{
+	*min_x = rank == 0 ? -INFINITY : domain_min_x + domain_strip_width * rank;
+	*max_x = rank == boid_domain_count - 1 ? INFINITY : domain_min_x + domain_strip_width * (rank + 1);
+}
+
+uint64_t boid_domain_make_uid(void)
+{
+	return ((uint64_t)boid_domain_rank << 48) | domain_next_uid++;
+}
+
+
+//
+// TRANSPORT
+//
+
+static int domain_write(int fd, const void* data, size_t bytes)
+{
+	const char* cptr = data;
+	ssize_t written;
+	while(bytes > 0)
+	{
+		if((written = write(fd, cptr, bytes)) <= 0)
+			return -1;
+		cptr += written;
+		bytes -= written;
+	}
+	return 0;
+}
+
+static int domain_read(int fd, void* data, size_t bytes)
+{
+	char* cptr = data;
+	ssize_t received;
+	while(bytes > 0)
+	{
+		if((received = read(fd, cptr, bytes)) <= 0)
+			return -1;
+		cptr += received;
+		bytes -= received;
+	}
+	return 0;
+}
+
+static int domain_send(domain_link_t* link)
+{
+	domain_header_t header = {
+		.halo_count = (uint32_t)link->halo.count,
+		.migrant_count = (uint32_t)link->migrants.count
+	};
+
+	return domain_write(link->fd, &header, sizeof(header))
+		|| domain_write(link->fd, link->halo.first, link->halo.count * sizeof(domain_record_t))
+		|| domain_write(link->fd, link->migrants.first, link->migrants.count * sizeof(domain_record_t));
+}
+
+static int domain_receive(domain_link_t* link)
+{
+	domain_header_t* header = &link->received_header;
+	if(domain_read(link->fd, header, sizeof(domain_header_t)))
+		return -1;
+
+	size_t count = (size_t)header->halo_count + header->migrant_count;
+	if(count > link->received.capacity)
+	{
+		link->received.capacity = count;
+		link->received.first = realloc(link->received.first, count * sizeof(domain_record_t));
+		assert(link->received.first != NULL);
+	}
+	link->received.count = count;
+
+	return domain_read(link->fd, link->received.first, count * sizeof(domain_record_t));
+}
+
+// one side of each link sends first so that neither blocks on a full socket buffer
+static int domain_exchange(domain_link_t* link, int send_first)
+{
+	if(link->fd < 0)
+		return 0;
+
+	int failed = send_first
+		? domain_send(link) || domain_receive(link)
+		: domain_receive(link) || domain_send(link);
+
+	if(failed)
+	{
+		SDL_Log("Lost connection to a neighbouring domain, continuing without it");
+		close(link->fd);
+		link->fd = -1;
+		link->received.count = 0;
+		link->received_header = (domain_header_t){ 0, 0 };
+	}
+
+	return failed;
+}
+
+
+//
+// HALO AND MIGRATION
+//
+
+static void domain_push_record(domain_records_t* records, boid_c* boid)
+{
+	if(records->count >= records->capacity)
+	{
+		records->capacity = records->capacity == 0 ? 64 : records->capacity * 2;
+		records->first = realloc(records->first, records->capacity * sizeof(domain_record_t));
+		assert(records->first != NULL);
+	}
+
+	records->first[records->count++] = (domain_record_t){
+		.uid = boid->uid,
+		.position = boid->position,
+		.velocity = boid->velocity
+	};
+}
+
+static void domain_push_ghost(uint64_t uid, ecsEntityId entity)
+{
+	if(domain_ghost_count >= domain_ghost_capacity)
+	{
+		domain_ghost_capacity = domain_ghost_capacity == 0 ? 64 : domain_ghost_capacity * 2;
+		domain_ghosts = realloc(domain_ghosts, domain_ghost_capacity * sizeof(domain_ghost_t));
+		assert(domain_ghosts != NULL);
+	}
+	domain_ghosts[domain_ghost_count++] = (domain_ghost_t){ uid, entity };
+}
+
+static void domain_push_idle(ecsEntityId entity)
+{
+	if(domain_idle_count >= domain_idle_capacity)
+	{
+		domain_idle_capacity = domain_idle_capacity == 0 ? 64 : domain_idle_capacity * 2;
+		domain_idle = realloc(domain_idle, domain_idle_capacity * sizeof(ecsEntityId));
+		assert(domain_idle != NULL);
+	}
+	domain_idle[domain_idle_count++] = entity;
+}
+
+static int compare_ghosts(const void* a, const void* b)
+{
+	const domain_ghost_t* l = a, *r = b;
+	return l->uid < r->uid ? -1 : (l->uid > r->uid);
+}
+
+// find the local copy of a boid owned by another process, or a free slot to hold it
+static boid_c* domain_find_slot(uint64_t uid, short* is_new)
+{
+	domain_ghost_t* ghost = bsearch(&(domain_ghost_t){ .uid = uid }, domain_ghosts, domain_ghost_count,
+									sizeof(domain_ghost_t), &compare_ghosts);
+	ecsEntityId entity;
+
+	*is_new = ghost == NULL;
+	if(ghost != NULL)
+		entity = ghost->entity;
+	else if(domain_idle_count > 0)
+	{
+		// the slot may still be listed as the boid it held before
+		entity = domain_idle[--domain_idle_count];
+		++boid_domain_generation;
+	}
+	else if((entity = ecsCreateEntity(boid_component)) == noentity)
+		return NULL;
+
+	return ecsGetComponentPtr(entity, boid_component);
+}
+
+static void domain_apply_records(domain_record_t* records, size_t count, boid_ownership_t ownership)
+{
+	boid_c* boid;
+	short is_new;
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		if((boid = domain_find_slot(records[i].uid, &is_new)) == NULL)
+			continue;
+
+		if(is_new)
+		{
+			(*boid) = (boid_c){
+				.uid = records[i].uid,
+				.near_origin = records[i].position
+			};
+			// a migrant that was never part of the halo cannot be in any neighbour list, force a rebuild
+			if(ownership == BOID_OWNED)
+				boid->near_origin = (fvec){ INFINITY, INFINITY };
+		}
+
+		boid->position = records[i].position;
+		boid->velocity = records[i].velocity;
+		boid->ownership = ownership;
+		boid->halo_step = boid_domain_step;
+	}
+}
+
+// Exchanges halo copies and migrating boids with the processes owning the neighbouring strips.
+// Boids keep their entity while they move between owned and halo, so neighbour lists stay valid across exchanges.
+void system_boid_domain_exchange(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	if(boid_domain_count <= 1) return;
+
+	boid_c* boid;
+	float min_x, max_x;
+	float halo = boid_max_range() + boid_near_skin;
+	int side;
+
+	++boid_domain_step;
+	boid_domain_strip(boid_domain_rank, &min_x, &max_x);
+
+	for(side = 0; side < DOMAIN_SIDES; ++side)
+	{
+		domain_links[side].halo.count = 0;
+		domain_links[side].migrants.count = 0;
+	}
+	domain_ghost_count = 0;
+	domain_idle_count = 0;
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		boid = ecsGetComponentPtr(entities[i], boid_component);
+
+		switch(boid->ownership)
+		{
+		case BOID_IDLE:
+			domain_push_idle(entities[i]);
+			break;
+		case BOID_HALO:
+			domain_push_ghost(boid->uid, entities[i]);
+			break;
+		default:
+			side = boid->position.x < min_x ? DOMAIN_LEFT : boid->position.x >= max_x ? DOMAIN_RIGHT : -1;
+			if(side >= 0 && domain_links[side].fd >= 0)
+			{
+				// hand the boid over and keep it as a halo copy, the new owner will keep it refreshed
+				domain_push_record(&domain_links[side].migrants, boid);
+				boid->ownership = BOID_HALO;
+				boid->halo_step = boid_domain_step;
+				domain_push_ghost(boid->uid, entities[i]);
+				break;
+			}
+			if(boid->position.x < min_x + halo && domain_links[DOMAIN_LEFT].fd >= 0)
+				domain_push_record(&domain_links[DOMAIN_LEFT].halo, boid);
+			if(boid->position.x >= max_x - halo && domain_links[DOMAIN_RIGHT].fd >= 0)
+				domain_push_record(&domain_links[DOMAIN_RIGHT].halo, boid);
+			break;
+		}
+	}
+
+	// exchange over even links first, then over odd links
+	int even = (boid_domain_rank & 1) == 0;
+	domain_exchange(&domain_links[even ? DOMAIN_RIGHT : DOMAIN_LEFT], even);
+	domain_exchange(&domain_links[even ? DOMAIN_LEFT : DOMAIN_RIGHT], !even);
+
+	qsort(domain_ghosts, domain_ghost_count, sizeof(domain_ghost_t), &compare_ghosts);
+
+	for(side = 0; side < DOMAIN_SIDES; ++side)
+	{
+		domain_link_t* link = &domain_links[side];
+		domain_apply_records(link->received.first, link->received_header.halo_count, BOID_HALO);
+		domain_apply_records(link->received.first + link->received_header.halo_count,
+							 link->received_header.migrant_count, BOID_OWNED);
+		link->received.count = 0;
+		link->received_header = (domain_header_t){ 0, 0 };
+	}
+
+	// halo copies that were not refreshed have left the halo
+	for(size_t i = 0; i < domain_ghost_count; ++i)
+	{
+		boid = ecsGetComponentPtr(domain_ghosts[i].entity, boid_component);
+		if(boid->ownership == BOID_HALO && boid->halo_step != boid_domain_step)
+		{
+			boid->ownership = BOID_IDLE;
+			++boid_domain_generation;
+		}
+	}
+}
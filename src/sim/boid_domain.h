@@ -0,0 +1,51 @@
+//
+//  boid_domain.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef boid_domain_h
+#define boid_domain_h
+
+#include <ecs.h>
+#include <stdint.h>
+#include <vec.h>
+
+struct SDL_Rect;
+
+// process index and number of processes splitting the arena, 0 and 1 when not distributed
+extern int boid_domain_rank;
+extern int boid_domain_count;
+// number of domain steps exchanged with the neighbouring processes
+extern uint32_t boid_domain_step;
+// changes whenever an entity stops holding the boid it held, neighbour lists built before then can hold stale entries
+extern uint32_t boid_domain_generation;
+
+/**
+ * \brief Splits area into boid_domain_count vertical strips and connects to the processes owning the neighbouring strips.
+ * \param rank The strip owned by this process.
+ * \param count The number of processes taking part.
+ * \param socket_dir Directory holding the unix domain sockets used to reach the other processes.
+ * \param area The arena to split, must be the same for every process.
+ * \returns 0 on success.
+ * \returns -1 if the sockets could not be set up.
+ * \note Blocks until both neighbouring processes have connected.
+ */
+extern int boid_domain_init(int rank, int count, const char* socket_dir, struct SDL_Rect* area);
+extern void boid_domain_quit(void);
+
+/**
+ * \brief Gets the horizontal extent of the strip owned by rank.
+ * \note The outermost strips extend to infinity so that every position has an owner.
+ */
+extern void boid_domain_strip(int rank, float* min_x, float* max_x);
+
+/**
+ * \brief Creates an id for a new boid that is unique across all processes.
+ */
+extern uint64_t boid_domain_make_uid(void);
+
+extern void system_boid_domain_exchange(ecsEntityId*, ecsComponentMask*, size_t, float);
+
+#endif /* boid_domain_h */
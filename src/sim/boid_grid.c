@@ -0,0 +1,324 @@
+//
+//  boid_grid.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "boid_grid.h"
+#include "boid_c.h"
+#include <SDL2/SDL.h>
+#include <assert.h>
+
+// limits the number of cells to a multiple of the number of boids when a few boids stray far away
+#define BOID_GRID_CELLS_PER_BOID (4)
+
+boid_grid_t boid_grid;
+arena_t boid_grid_arena;
+
+size_t* boid_grid_cells; // cell of each boid while building
+boid_grid_entry_t* boid_grid_unsorted;
+size_t boid_grid_entry_capacity;
+size_t boid_grid_cell_capacity;
+
+static inline int boid_grid_clamp(int v, int max)
+{
+	return v < 0 ? 0 : v >= max ? max - 1 : v;
+}
+
+static inline int boid_grid_cell_x(float x)
+{
+	return boid_grid_clamp((int)floorf((x - boid_grid.origin.x) / boid_grid.cell_size), boid_grid.cells_w);
+}
+
+static inline int boid_grid_cell_y(float y)
+{
+	return boid_grid_clamp((int)floorf((y - boid_grid.origin.y) / boid_grid.cell_size), boid_grid.cells_h);
+}
+
+// adds a copy of a boid shifted by a whole area, so queries near one edge find it through the other
+static inline void boid_grid_add_ghost(size_t* live, fvec* position, float dx, float dy, ecsEntityId entity)
+{
+	boid_grid_unsorted[(*live)++] = (boid_grid_entry_t){ { position->x + dx, position->y + dy }, entity };
+}
+
+void boid_grid_build(ecsEntityId* entities, size_t count, float cell_size)
+{
+	boid_c* boid;
+	fvec min = {INFINITY, INFINITY}, max = {-INFINITY, -INFINITY};
+	float area_x = (float)boid_available_area.x, area_y = (float)boid_available_area.y;
+	float area_w = (float)boid_available_area.w, area_h = (float)boid_available_area.h;
+	
+	// in a periodic world boids within the ghost width of an edge are copied past the opposite edge,
+	// so neighbours across the seam are found with plain distances, at most three copies per boid
+	short periodic = boid_periodic && area_w > 0.f && area_h > 0.f;
+	float ghost = fmaxf(cell_size, cohesion.range);
+	size_t capacity = periodic ? count * 4 : count;
+
+	if(capacity > boid_grid_entry_capacity)
+	{
+		size_t old = boid_grid_entry_capacity;
+		boid_grid_entry_capacity = capacity;
+		boid_grid.entries = arenaRealloc(&boid_grid_arena, boid_grid.entries,
+										 old * sizeof(boid_grid_entry_t), capacity * sizeof(boid_grid_entry_t));
+		boid_grid_unsorted = arenaRealloc(&boid_grid_arena, boid_grid_unsorted,
+										  old * sizeof(boid_grid_entry_t), capacity * sizeof(boid_grid_entry_t));
+		boid_grid_cells = arenaRealloc(&boid_grid_arena, boid_grid_cells, old * sizeof(size_t), capacity * sizeof(size_t));
+		assert(boid_grid.entries != NULL && boid_grid_unsorted != NULL && boid_grid_cells != NULL);
+	}
+
+	// idle halo slots are not boids and are left out
+	size_t live = 0;
+	for(size_t i = 0; i < count; ++i)
+	{
+		boid = ecsGetComponentPtr(entities[i], boid_component);
+		if(boid->ownership == BOID_IDLE) continue;
+
+		boid_grid_unsorted[live++] = (boid_grid_entry_t){ boid->position, entities[i] };
+		min.x = fminf(min.x, boid->position.x); min.y = fminf(min.y, boid->position.y);
+		max.x = fmaxf(max.x, boid->position.x); max.y = fmaxf(max.y, boid->position.y);
+
+		if(!periodic) continue;
+
+		float dx = boid->position.x - area_x < ghost ? area_w : area_x + area_w - boid->position.x <= ghost ? -area_w : 0.f;
+		float dy = boid->position.y - area_y < ghost ? area_h : area_y + area_h - boid->position.y <= ghost ? -area_h : 0.f;
+		if(dx != 0.f) boid_grid_add_ghost(&live, &boid->position, dx, 0.f, entities[i]);
+		if(dy != 0.f) boid_grid_add_ghost(&live, &boid->position, 0.f, dy, entities[i]);
+		if(dx != 0.f && dy != 0.f) boid_grid_add_ghost(&live, &boid->position, dx, dy, entities[i]);
+	}
+
+	if(periodic)
+	{
+		// the area and its ghosts are all there is
+		min = (fvec){ area_x - ghost, area_y - ghost };
+		max = (fvec){ area_x + area_w + ghost, area_y + area_h + ghost };
+	}
+	else
+	{
+		// boids that stray far outside the arena share the edge cells rather than stretching the grid
+		float margin = wall_avoid.range + cell_size;
+		min.x = fmaxf(min.x, area_x - margin);
+		min.y = fmaxf(min.y, area_y - margin);
+		max.x = fminf(max.x, area_x + area_w + margin);
+		max.y = fminf(max.y, area_y + area_h + margin);
+	}
+
+	if(live == 0)
+		min = max = (fvec){ 0.f, 0.f };
+	max.x = fmaxf(max.x, min.x);
+	max.y = fmaxf(max.y, min.y);
+
+	// cover the bounds of all boids, growing cells if that would take too many of them
+	size_t max_cells = live * BOID_GRID_CELLS_PER_BOID + 1;
+	do
+	{
+		boid_grid.cells_w = (int)((max.x - min.x) / cell_size) + 1;
+		boid_grid.cells_h = (int)((max.y - min.y) / cell_size) + 1;
+		cell_size *= 2.f;
+	} while((size_t)boid_grid.cells_w * boid_grid.cells_h > max_cells);
+
+	boid_grid.origin = min;
+	boid_grid.cell_size = cell_size * 0.5f;
+	boid_grid.count = live;
+
+	size_t cells = (size_t)boid_grid.cells_w * boid_grid.cells_h;
+	if(cells + 1 > boid_grid_cell_capacity)
+	{
+		boid_grid.cell_start = arenaRealloc(&boid_grid_arena, boid_grid.cell_start,
+											boid_grid_cell_capacity * sizeof(size_t), (cells + 1) * sizeof(size_t));
+		boid_grid_cell_capacity = cells + 1;
+		assert(boid_grid.cell_start != NULL);
+	}
+
+	// counting sort of the entries by cell
+	memset(boid_grid.cell_start, 0, (cells + 1) * sizeof(size_t));
+	for(size_t i = 0; i < live; ++i)
+	{
+		boid_grid_cells[i] = (size_t)boid_grid_cell_y(boid_grid_unsorted[i].position.y) * boid_grid.cells_w
+			+ boid_grid_cell_x(boid_grid_unsorted[i].position.x);
+		++boid_grid.cell_start[boid_grid_cells[i]];
+	}
+
+	size_t start = 0, cell_count;
+	for(size_t i = 0; i < cells; ++i)
+	{
+		cell_count = boid_grid.cell_start[i];
+		boid_grid.cell_start[i] = start;
+		start += cell_count;
+	}
+
+	// entries within a cell keep storage order
+	for(size_t i = 0; i < live; ++i)
+		boid_grid.entries[boid_grid.cell_start[boid_grid_cells[i]]++] = boid_grid_unsorted[i];
+
+	// every cell_start now holds the start of the next cell, shift them back into place
+	memmove(boid_grid.cell_start + 1, boid_grid.cell_start, cells * sizeof(size_t));
+	boid_grid.cell_start[0] = 0;
+}
+
+size_t boid_grid_query_radius(fvec* centre, float radius, ecsEntityId* out, size_t max_out)
+{
+	if(boid_grid.count == 0) return 0;
+
+	float sqr_radius = radius * radius;
+	int x0 = boid_grid_cell_x(centre->x - radius), x1 = boid_grid_cell_x(centre->x + radius);
+	int y0 = boid_grid_cell_y(centre->y - radius), y1 = boid_grid_cell_y(centre->y + radius);
+	boid_grid_entry_t* entry, *end;
+	size_t hits = 0;
+
+	for(int y = y0; y <= y1; ++y)
+	{
+		for(int x = x0; x <= x1; ++x)
+		{
+			size_t cell = (size_t)y * boid_grid.cells_w + x;
+			end = boid_grid.entries + boid_grid.cell_start[cell + 1];
+			for(entry = boid_grid.entries + boid_grid.cell_start[cell]; entry < end; ++entry)
+			{
+				if(vsqrdist(&entry->position, centre) < sqr_radius)
+				{
+					if(hits >= max_out) return hits;
+					out[hits++] = entry->entity;
+				}
+			}
+		}
+	}
+
+	return hits;
+}
+
+static inline short boid_grid_hit_farther(boid_grid_hit_t* a, boid_grid_hit_t* b)
+{
+	// ties go by entity so that equal distances resolve the same way every time
+	return a->sqr_dist > b->sqr_dist || (a->sqr_dist == b->sqr_dist && a->entity > b->entity);
+}
+
+// restores the max-heap below index after its hit was replaced
+static void boid_grid_heap_down(boid_grid_hit_t* heap, size_t count, size_t index)
+{
+	boid_grid_hit_t hit = heap[index];
+	size_t child;
+
+	while((child = index * 2 + 1) < count)
+	{
+		if(child + 1 < count && boid_grid_hit_farther(&heap[child + 1], &heap[child]))
+			++child;
+		if(!boid_grid_hit_farther(&heap[child], &hit))
+			break;
+		heap[index] = heap[child];
+		index = child;
+	}
+	heap[index] = hit;
+}
+
+static void boid_grid_heap_up(boid_grid_hit_t* heap, size_t index)
+{
+	boid_grid_hit_t hit = heap[index];
+	size_t parent;
+
+	while(index > 0 && boid_grid_hit_farther(&hit, &heap[parent = (index - 1) / 2]))
+	{
+		heap[index] = heap[parent];
+		index = parent;
+	}
+	heap[index] = hit;
+}
+
+size_t boid_grid_query_nearest(fvec* centre, float radius, boid_grid_hit_t* hits, size_t k)
+{
+	if(boid_grid.count == 0 || k == 0) return 0;
+
+	// hits is kept as a max-heap on distance, once full a candidate only gets in by beating the farthest
+	float sqr_radius = radius * radius;
+	int x0 = boid_grid_cell_x(centre->x - radius), x1 = boid_grid_cell_x(centre->x + radius);
+	int y0 = boid_grid_cell_y(centre->y - radius), y1 = boid_grid_cell_y(centre->y + radius);
+	boid_grid_entry_t* entry, *end;
+	boid_grid_hit_t hit;
+	size_t count = 0;
+
+	for(int y = y0; y <= y1; ++y)
+	{
+		for(int x = x0; x <= x1; ++x)
+		{
+			size_t cell = (size_t)y * boid_grid.cells_w + x;
+			end = boid_grid.entries + boid_grid.cell_start[cell + 1];
+			for(entry = boid_grid.entries + boid_grid.cell_start[cell]; entry < end; ++entry)
+			{
+				hit.sqr_dist = vsqrdist(&entry->position, centre);
+				if(hit.sqr_dist >= sqr_radius) continue;
+				hit.entity = entry->entity;
+
+				if(count < k)
+				{
+					hits[count] = hit;
+					boid_grid_heap_up(hits, count++);
+				}
+				else if(boid_grid_hit_farther(&hits[0], &hit))
+				{
+					hits[0] = hit;
+					boid_grid_heap_down(hits, count, 0);
+				}
+			}
+		}
+	}
+
+	// heap sort, the farthest remaining hit moves to the back each time
+	for(size_t n = count; n > 1; --n)
+	{
+		hit = hits[0];
+		hits[0] = hits[n - 1];
+		hits[n - 1] = hit;
+		boid_grid_heap_down(hits, n - 1, 0);
+	}
+
+	return count;
+}
+
+size_t boid_grid_query_rect(fvec* min, fvec* max, ecsEntityId* out, size_t max_out)
+{
+	if(boid_grid.count == 0) return 0;
+
+	int x0 = boid_grid_cell_x(min->x), x1 = boid_grid_cell_x(max->x);
+	int y0 = boid_grid_cell_y(min->y), y1 = boid_grid_cell_y(max->y);
+	boid_grid_entry_t* entry, *end;
+	size_t hits = 0;
+
+	for(int y = y0; y <= y1; ++y)
+	{
+		for(int x = x0; x <= x1; ++x)
+		{
+			size_t cell = (size_t)y * boid_grid.cells_w + x;
+			end = boid_grid.entries + boid_grid.cell_start[cell + 1];
+			for(entry = boid_grid.entries + boid_grid.cell_start[cell]; entry < end; ++entry)
+			{
+				if(entry->position.x >= min->x && entry->position.x <= max->x
+				   && entry->position.y >= min->y && entry->position.y <= max->y)
+				{
+					if(hits >= max_out) return hits;
+					out[hits++] = entry->entity;
+				}
+			}
+		}
+	}
+
+	return hits;
+}
+
+void boid_grid_init(int arena_flags)
+{
+	// one chunk holds the grid of around 100k boids
+	arenaInit(&boid_grid_arena, "boid grid", arena_flags, 4 << 20);
+}
+
+void boid_grid_terminate(void)
+{
+	arenaTerminate(&boid_grid_arena);
+	memset(&boid_grid, 0, sizeof(boid_grid_t));
+	boid_grid_unsorted = NULL;
+	boid_grid_cells = NULL;
+	boid_grid_entry_capacity = boid_grid_cell_capacity = 0;
+}
+
+void system_boid_grid_build(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	boid_grid_build(entities, count, boid_max_range() + boid_near_skin);
+}
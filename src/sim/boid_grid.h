@@ -0,0 +1,76 @@
+//
+//  boid_grid.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef boid_grid_h
+#define boid_grid_h
+
+#include <ecs.h>
+#include <vec.h>
+#include <arena.h>
+
+// uniform grid over boid positions, rebuilt every frame by system_boid_grid_build,
+// when boid_periodic is set boids near an edge also have a ghost entry shifted past the opposite edge
+typedef struct boid_grid_entry_t {
+	fvec position;
+	ecsEntityId entity;
+} boid_grid_entry_t;
+
+// a boid found by boid_grid_query_nearest
+typedef struct boid_grid_hit_t {
+	float sqr_dist;
+	ecsEntityId entity;
+} boid_grid_hit_t;
+
+typedef struct boid_grid_t {
+	fvec origin;
+	float cell_size;
+	int cells_w, cells_h;
+	size_t* cell_start; // entries of cell i are [cell_start[i], cell_start[i+1])
+	boid_grid_entry_t* entries;
+	size_t count;
+} boid_grid_t;
+
+extern boid_grid_t boid_grid;
+// backs the per-boid buffers of the grid
+extern arena_t boid_grid_arena;
+
+/**
+ * \brief Finds boids within radius of centre.
+ * \param out Receives the entities found.
+ * \param max_out The maximum number of entities to write to out.
+ * \returns The number of entities written to out.
+ * \note Only the grid cells overlapping the circle are visited.
+ */
+extern size_t boid_grid_query_radius(fvec* centre, float radius, ecsEntityId* out, size_t max_out);
+
+/**
+ * \brief Finds the k boids nearest to centre within radius.
+ * \param hits Receives the boids found, nearest first, must have room for k.
+ * \returns The number of boids written to hits.
+ * \note Unlike boid_grid_query_radius the result does not depend on the order boids are stored in.
+ */
+extern size_t boid_grid_query_nearest(fvec* centre, float radius, boid_grid_hit_t* hits, size_t k);
+
+/**
+ * \brief Finds boids within the rectangle from min to max.
+ * \param out Receives the entities found.
+ * \param max_out The maximum number of entities to write to out.
+ * \returns The number of entities written to out.
+ */
+extern size_t boid_grid_query_rect(fvec* min, fvec* max, ecsEntityId* out, size_t max_out);
+
+/**
+ * \brief Rebuilds the grid from the positions of entities.
+ * \param cell_size The size of a grid cell, queries are cheapest when this is close to their radius.
+ */
+extern void boid_grid_build(ecsEntityId* entities, size_t count, float cell_size);
+extern void boid_grid_init(int arena_flags);
+extern void boid_grid_terminate(void);
+
+extern void system_boid_grid_build(ecsEntityId*, ecsComponentMask*, size_t, float);
+
+#endif /* boid_grid_h */
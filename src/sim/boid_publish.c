@@ -0,0 +1,115 @@
+//
+//  boid_publish.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "boid_publish.h"
+#include "boid_c.h"
+#include <SDL2/SDL.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+boid_publish_header_t* publish_header = NULL;
+size_t publish_bytes;
+char* publish_name;
+uint64_t publish_frame;
+
+int boid_publish_open(const char* name, uint32_t capacity, uint32_t frame_count)
+{
+	if(publish_header != NULL)
+		boid_publish_close();
+
+	// keep every frame on its own cache lines
+	uint64_t frame_bytes = sizeof(boid_frame_t) + (uint64_t)capacity * 2 * sizeof(fvec);
+	frame_bytes = (frame_bytes + 63) & ~(uint64_t)63;
+	publish_bytes = sizeof(boid_publish_header_t) + frame_bytes * frame_count;
+
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if(fd < 0)
+	{
+		SDL_Log("Failed to create shared memory %s", name);
+		return -1;
+	}
+
+	if(ftruncate(fd, publish_bytes) != 0)
+	{
+		SDL_Log("Failed to size shared memory %s", name);
+		close(fd);
+		shm_unlink(name);
+		return -1;
+	}
+
+	void* memory = mmap(NULL, publish_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(memory == MAP_FAILED)
+	{
+		SDL_Log("Failed to map shared memory %s", name);
+		shm_unlink(name);
+		return -1;
+	}
+
+	publish_header = memory;
+	memset(publish_header, 0, publish_bytes);
+	publish_name = strdup(name);
+	publish_frame = 0;
+
+	publish_header->frame_count = frame_count;
+	publish_header->capacity = capacity;
+	publish_header->frame_bytes = frame_bytes;
+	publish_header->version = BOID_PUBLISH_VERSION;
+	// readers check the magic last, publish it once the rest of the header is valid
+	__atomic_store_n(&publish_header->magic, BOID_PUBLISH_MAGIC, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+void boid_publish_close(void)
+{
+	if(publish_header == NULL)
+		return;
+
+	munmap(publish_header, publish_bytes);
+	shm_unlink(publish_name);
+	free(publish_name);
+	publish_header = NULL;
+	publish_name = NULL;
+}
+
+void system_boid_publish(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	if(publish_header == NULL) return;
+
+	boid_c* boid;
+	uint32_t capacity = publish_header->capacity;
+	uint64_t index = publish_frame % publish_header->frame_count;
+	boid_frame_t* frame = boid_publish_frame(publish_header, index);
+	fvec* positions = boid_frame_positions(frame);
+	fvec* velocities = boid_frame_velocities(frame, capacity);
+	uint32_t written = 0;
+
+	// mark the frame as being written
+	uint64_t sequence = __atomic_load_n(&frame->sequence, __ATOMIC_RELAXED);
+	__atomic_store_n(&frame->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	for(size_t i = 0; i < count && written < capacity; ++i)
+	{
+		boid = ecsGetComponentPtr(entities[i], boid_component);
+		if(boid->ownership != BOID_OWNED) continue;
+
+		positions[written] = boid->position;
+		velocities[written] = boid->velocity;
+		++written;
+	}
+
+	frame->count = written;
+	frame->frame = publish_frame++;
+
+	__atomic_store_n(&frame->sequence, sequence + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&publish_header->latest, index, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,66 @@
+//
+//  boid_publish.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef boid_publish_h
+#define boid_publish_h
+
+#include <ecs.h>
+#include <stdint.h>
+#include <vec.h>
+
+// Boid state is published into a POSIX shared memory object laid out as a boid_publish_header_t
+// followed by frame_count frames of frame_bytes each. Every frame starts with a boid_frame_t followed by
+// capacity positions and then capacity velocities.
+//
+// Readers map the object read-only and, for the frame at index latest:
+//  1. load sequence with acquire semantics, retrying while it is odd,
+//  2. read count, positions and velocities in place,
+//  3. issue an acquire fence, load sequence again and retry if it changed.
+// The writer only reuses a frame after frame_count newer frames, so readers rarely have to retry.
+
+#define BOID_PUBLISH_MAGIC (0x44494f42)
+#define BOID_PUBLISH_VERSION (1)
+
+typedef struct boid_publish_header_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t frame_count;
+	uint32_t capacity;
+	uint64_t frame_bytes;
+	uint64_t latest; // index of the most recently completed frame
+} boid_publish_header_t;
+
+typedef struct boid_frame_t {
+	uint64_t sequence; // odd while the frame is being written
+	uint64_t frame; // number of frames published before this one
+	uint32_t count;
+	uint32_t padding;
+} boid_frame_t;
+
+static inline fvec* boid_frame_positions(boid_frame_t* frame)
+{ return (fvec*)(frame + 1); }
+
+static inline fvec* boid_frame_velocities(boid_frame_t* frame, uint32_t capacity)
+{ return boid_frame_positions(frame) + capacity; }
+
+static inline boid_frame_t* boid_publish_frame(boid_publish_header_t* header, uint64_t index)
+{ return (boid_frame_t*)((char*)(header + 1) + index * header->frame_bytes); }
+
+/**
+ * \brief Creates a shared memory object for publishing boid state to other processes.
+ * \param name The name of the shared memory object, starting with a '/'.
+ * \param capacity The maximum number of boids in a frame, further boids are not published.
+ * \param frame_count The number of frames in the ring.
+ * \returns 0 on success.
+ * \returns -1 if the shared memory object could not be created.
+ */
+extern int boid_publish_open(const char* name, uint32_t capacity, uint32_t frame_count);
+extern void boid_publish_close(void);
+
+extern void system_boid_publish(ecsEntityId*, ecsComponentMask*, size_t, float);
+
+#endif /* boid_publish_h */
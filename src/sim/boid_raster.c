@@ -0,0 +1,374 @@
+//
+//  boid_raster.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "boid_raster.h"
+#include "boid_c.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define BOID_RASTER_OBSTACLE_COLOR (0xFFC83C3C)
+#define BOID_RASTER_BOID_COLOR (0xFFFFFFFF)
+
+boid_raster_t boid_raster;
+int boid_raster_interval = 10;
+const char* boid_raster_path = "boids_%06d.ppm";
+
+// what the tile threads draw this frame, prepared by boid_raster_draw
+boid_snapshot_t* boid_raster_snapshot;
+uint32_t* boid_raster_cells; // boids per density map cell, then the opaque colour of the cell
+size_t boid_raster_cell_capacity;
+int boid_raster_cells_w, boid_raster_cells_h;
+short boid_raster_lod;
+
+// visible boids binned by every tile their sprite touches
+int boid_raster_tiles_w, boid_raster_tiles_h;
+uint32_t* boid_raster_tile_start; // boids of tile i are [tile_start[i], tile_start[i+1])
+uint32_t* boid_raster_tile_boids;
+size_t boid_raster_tile_capacity;
+
+SDL_Thread* boid_raster_threads[BOID_RASTER_MAX_THREADS];
+int boid_raster_thread_count;
+SDL_sem* boid_raster_start, *boid_raster_done;
+int boid_raster_next_tile;
+int boid_raster_quit;
+
+static inline int boid_raster_min(int a, int b) { return a < b ? a : b; }
+static inline int boid_raster_max(int a, int b) { return a > b ? a : b; }
+
+// the density map cell a position is in, or -1 when off screen
+static inline long boid_raster_cell(fvec* position)
+{
+	if(position->x < 0.f || position->y < 0.f) return -1;
+	int cx = (int)position->x / boid_lod_cell_size;
+	int cy = (int)position->y / boid_lod_cell_size;
+	if(cx >= boid_raster_cells_w || cy >= boid_raster_cells_h) return -1;
+	return (long)cy * boid_raster_cells_w + cx;
+}
+
+// the sprite of a boid, an arrow along its velocity covering the same five pixels as the texture
+static void boid_raster_boid(fvec* position, fvec* velocity, int x0, int y0, int x1, int y1)
+{
+	fvec dir = *velocity, perp;
+	if(vmag(&dir) > 0.f) vnor(&dir, &dir);
+	else dir = (fvec){ 0.f, 1.f };
+	perp = (fvec){ -dir.y, dir.x };
+
+	fvec v[3] = {
+		{ position->x + dir.x * 2.5f, position->y + dir.y * 2.5f },
+		{ position->x - dir.x * 2.5f + perp.x * 2.f, position->y - dir.y * 2.5f + perp.y * 2.f },
+		{ position->x - dir.x * 2.5f - perp.x * 2.f, position->y - dir.y * 2.5f - perp.y * 2.f },
+	};
+
+	// pixels whose centre lies on the inner side of all three edges, either winding
+	x0 = boid_raster_max(x0, (int)floorf(position->x - 3.f)); x1 = boid_raster_min(x1, (int)ceilf(position->x + 3.f));
+	y0 = boid_raster_max(y0, (int)floorf(position->y - 3.f)); y1 = boid_raster_min(y1, (int)ceilf(position->y + 3.f));
+	for(int y = y0; y < y1; ++y)
+	{
+		uint32_t* row = boid_raster.pixels + (size_t)y * boid_raster.width;
+		for(int x = x0; x < x1; ++x)
+		{
+			float px = (float)x + .5f, py = (float)y + .5f;
+			float e0 = (v[1].x - v[0].x) * (py - v[0].y) - (v[1].y - v[0].y) * (px - v[0].x);
+			float e1 = (v[2].x - v[1].x) * (py - v[1].y) - (v[2].y - v[1].y) * (px - v[1].x);
+			float e2 = (v[0].x - v[2].x) * (py - v[2].y) - (v[0].y - v[2].y) * (px - v[2].x);
+			if((e0 >= 0.f && e1 >= 0.f && e2 >= 0.f) || (e0 <= 0.f && e1 <= 0.f && e2 <= 0.f))
+				row[x] = BOID_RASTER_BOID_COLOR;
+		}
+	}
+}
+
+// a one pixel outline, like draw_obstacles
+static void boid_raster_obstacle(obstacle_t* obstacle, int x0, int y0, int x1, int y1)
+{
+	fvec* c = &obstacle->centre, *e = &obstacle->extents;
+	float reach = obstacle->shape == OBSTACLE_CIRCLE ? e->x : fmaxf(e->x, e->y) * 1.5f;
+
+	x0 = boid_raster_max(x0, (int)floorf(c->x - reach - 1.f)); x1 = boid_raster_min(x1, (int)ceilf(c->x + reach + 1.f));
+	y0 = boid_raster_max(y0, (int)floorf(c->y - reach - 1.f)); y1 = boid_raster_min(y1, (int)ceilf(c->y + reach + 1.f));
+	for(int y = y0; y < y1; ++y)
+	{
+		for(int x = x0; x < x1; ++x)
+		{
+			float dx = (float)x + .5f - c->x, dy = (float)y + .5f - c->y, d;
+			if(obstacle->shape == OBSTACLE_CIRCLE)
+			{
+				d = sqrtf(dx * dx + dy * dy) - e->x;
+			}
+			else
+			{
+				float qx = fabsf(dx) - e->x, qy = fabsf(dy) - e->y;
+				d = sqrtf(fmaxf(qx, 0.f) * fmaxf(qx, 0.f) + fmaxf(qy, 0.f) * fmaxf(qy, 0.f)) + fminf(fmaxf(qx, qy), 0.f);
+			}
+			if(fabsf(d) < .5f)
+				boid_raster.pixels[(size_t)y * boid_raster.width + x] = BOID_RASTER_OBSTACLE_COLOR;
+		}
+	}
+}
+
+static void boid_raster_tile(int tile)
+{
+	boid_snapshot_t* snapshot = boid_raster_snapshot;
+	int x0 = (tile % boid_raster_tiles_w) * BOID_RASTER_TILE, y0 = (tile / boid_raster_tiles_w) * BOID_RASTER_TILE;
+	int x1 = boid_raster_min(x0 + BOID_RASTER_TILE, boid_raster.width);
+	int y1 = boid_raster_min(y0 + BOID_RASTER_TILE, boid_raster.height);
+
+	// density map or black underneath
+	for(int y = y0; y < y1; ++y)
+	{
+		uint32_t* row = boid_raster.pixels + (size_t)y * boid_raster.width;
+		uint32_t* cells = boid_raster_cells + (size_t)(y / boid_lod_cell_size) * boid_raster_cells_w;
+		for(int x = x0; x < x1; ++x)
+			row[x] = boid_raster_lod ? cells[x / boid_lod_cell_size] : 0xFF000000;
+	}
+
+	for(uint32_t i = boid_raster_tile_start[tile]; i < boid_raster_tile_start[tile + 1]; ++i)
+	{
+		uint32_t boid = boid_raster_tile_boids[i];
+		boid_raster_boid(&snapshot->position[boid], &snapshot->velocity[boid], x0, y0, x1, y1);
+	}
+
+	for(size_t i = 0; i < snapshot->obstacle_count; ++i)
+		boid_raster_obstacle(&snapshot->obstacles[i], x0, y0, x1, y1);
+}
+
+static void boid_raster_work(void)
+{
+	int tiles = boid_raster_tiles_w * boid_raster_tiles_h, tile;
+	while((tile = __atomic_fetch_add(&boid_raster_next_tile, 1, __ATOMIC_RELAXED)) < tiles)
+		boid_raster_tile(tile);
+}
+
+static int boid_raster_thread(void* data)
+{
+	while(1)
+	{
+		SDL_SemWait(boid_raster_start);
+		if(__atomic_load_n(&boid_raster_quit, __ATOMIC_ACQUIRE)) break;
+		boid_raster_work();
+		SDL_SemPost(boid_raster_done);
+	}
+	return 0;
+}
+
+// calls fn for every tile the sprite of a boid touches
+#define BOID_RASTER_FOR_TILES(__position, __fn)\
+{\
+	int tx0 = boid_raster_max((int)floorf((__position)->x - 3.f), 0) / BOID_RASTER_TILE;\
+	int ty0 = boid_raster_max((int)floorf((__position)->y - 3.f), 0) / BOID_RASTER_TILE;\
+	int tx1 = boid_raster_min((int)ceilf((__position)->x + 3.f), boid_raster.width - 1) / BOID_RASTER_TILE;\
+	int ty1 = boid_raster_min((int)ceilf((__position)->y + 3.f), boid_raster.height - 1) / BOID_RASTER_TILE;\
+	for(int ty = ty0; ty <= ty1; ++ty)\
+		for(int tx = tx0; tx <= tx1; ++tx)\
+			__fn(ty * boid_raster_tiles_w + tx);\
+}
+
+void boid_raster_draw(boid_snapshot_t* snapshot)
+{
+	fvec* position;
+	long cell;
+	size_t on_screen = 0, bins = 0;
+	uint32_t max_count = 0;
+	int tiles = boid_raster_tiles_w * boid_raster_tiles_h;
+
+	if(boid_raster.pixels == NULL) return;
+
+	// the same density test as draw_boids
+	boid_raster_cells_w = (boid_raster.width + boid_lod_cell_size - 1) / boid_lod_cell_size;
+	boid_raster_cells_h = (boid_raster.height + boid_lod_cell_size - 1) / boid_lod_cell_size;
+	size_t cell_count = (size_t)boid_raster_cells_w * boid_raster_cells_h;
+	if(cell_count > boid_raster_cell_capacity)
+	{
+		boid_raster_cell_capacity = cell_count;
+		boid_raster_cells = realloc(boid_raster_cells, cell_count * sizeof(uint32_t));
+		assert(boid_raster_cells != NULL);
+	}
+	memset(boid_raster_cells, 0, cell_count * sizeof(uint32_t));
+
+	for(size_t i = 0; i < snapshot->count; ++i)
+	{
+		if((cell = boid_raster_cell(&snapshot->position[i])) < 0) continue;
+		++on_screen;
+		if(++boid_raster_cells[cell] > max_count)
+			max_count = boid_raster_cells[cell];
+	}
+
+	boid_raster_lod = (float)on_screen > boid_lod_density * (float)boid_raster.width * (float)boid_raster.height;
+
+	// bin the boids that are drawn as sprites by tile, before the cell counts turn into colours
+	memset(boid_raster_tile_start, 0, (tiles + 1) * sizeof(uint32_t));
+	for(size_t i = 0; i < snapshot->count; ++i)
+	{
+		position = &snapshot->position[i];
+		if(position->x < -3.f || position->y < -3.f
+		   || position->x >= boid_raster.width + 3.f || position->y >= boid_raster.height + 3.f) continue;
+		if(boid_raster_lod && ((cell = boid_raster_cell(position)) < 0
+							   || boid_raster_cells[cell] > (uint32_t)boid_lod_sparse_count)) continue;
+
+		#define BOID_RASTER_COUNT(__tile) { ++boid_raster_tile_start[__tile]; ++bins; }
+		BOID_RASTER_FOR_TILES(position, BOID_RASTER_COUNT)
+		#undef BOID_RASTER_COUNT
+	}
+
+	if(bins > boid_raster_tile_capacity)
+	{
+		boid_raster_tile_capacity = bins;
+		boid_raster_tile_boids = realloc(boid_raster_tile_boids, bins * sizeof(uint32_t));
+		assert(boid_raster_tile_boids != NULL);
+	}
+
+	uint32_t start = 0, tile_count;
+	for(int i = 0; i < tiles; ++i)
+	{
+		tile_count = boid_raster_tile_start[i];
+		boid_raster_tile_start[i] = start;
+		start += tile_count;
+	}
+
+	for(size_t i = 0; i < snapshot->count; ++i)
+	{
+		position = &snapshot->position[i];
+		if(position->x < -3.f || position->y < -3.f
+		   || position->x >= boid_raster.width + 3.f || position->y >= boid_raster.height + 3.f) continue;
+		if(boid_raster_lod && ((cell = boid_raster_cell(position)) < 0
+							   || boid_raster_cells[cell] > (uint32_t)boid_lod_sparse_count)) continue;
+
+		#define BOID_RASTER_FILL(__tile) { boid_raster_tile_boids[boid_raster_tile_start[__tile]++] = (uint32_t)i; }
+		BOID_RASTER_FOR_TILES(position, BOID_RASTER_FILL)
+		#undef BOID_RASTER_FILL
+	}
+
+	// every tile_start now holds the start of the next tile, shift them back into place
+	memmove(boid_raster_tile_start + 1, boid_raster_tile_start, tiles * sizeof(uint32_t));
+	boid_raster_tile_start[0] = 0;
+
+	// density colours blended over black once per cell rather than once per pixel
+	if(boid_raster_lod)
+	{
+		float scale = boid_lod_scale(max_count);
+		for(size_t i = 0; i < cell_count; ++i)
+		{
+			uint32_t color = boid_lod_color(boid_raster_cells[i], scale), alpha = color >> 24;
+			boid_raster_cells[i] = 0xFF000000
+				| ((((color >> 16) & 0xFF) * alpha / 255) << 16)
+				| ((((color >> 8) & 0xFF) * alpha / 255) << 8)
+				| ((color & 0xFF) * alpha / 255);
+		}
+	}
+
+	// tiles are handed out one at a time, so threads that get cheap tiles take more of them
+	boid_raster_snapshot = snapshot;
+	__atomic_store_n(&boid_raster_next_tile, 0, __ATOMIC_RELEASE);
+	for(int i = 0; i < boid_raster_thread_count; ++i)
+		SDL_SemPost(boid_raster_start);
+	boid_raster_work();
+	for(int i = 0; i < boid_raster_thread_count; ++i)
+		SDL_SemWait(boid_raster_done);
+}
+
+int boid_raster_write(const char* path)
+{
+	size_t length = strlen(path);
+
+	if(length > 4 && strcmp(path + length - 4, ".png") == 0)
+	{
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(boid_raster.pixels, boid_raster.width, boid_raster.height,
+																  32, boid_raster.width * 4, SDL_PIXELFORMAT_ARGB8888);
+		int result = surface != NULL ? IMG_SavePNG(surface, path) : -1;
+		if(surface != NULL)
+			SDL_FreeSurface(surface);
+		if(result != 0)
+			SDL_Log("Failed to write %s: %s", path, SDL_GetError());
+		return result != 0;
+	}
+
+	FILE* file = fopen(path, "wb");
+	if(file == NULL)
+	{
+		SDL_Log("Failed to open %s", path);
+		return 1;
+	}
+
+	// binary ppm, rgb without the alpha byte
+	uint8_t* row = malloc((size_t)boid_raster.width * 3);
+	int result = row == NULL || fprintf(file, "P6\n%d %d\n255\n", boid_raster.width, boid_raster.height) < 0;
+	for(int y = 0; y < boid_raster.height && !result; ++y)
+	{
+		uint32_t* pixels = boid_raster.pixels + (size_t)y * boid_raster.width;
+		for(int x = 0; x < boid_raster.width; ++x)
+		{
+			row[x * 3] = (uint8_t)(pixels[x] >> 16);
+			row[x * 3 + 1] = (uint8_t)(pixels[x] >> 8);
+			row[x * 3 + 2] = (uint8_t)pixels[x];
+		}
+		result = fwrite(row, 3, boid_raster.width, file) != (size_t)boid_raster.width;
+	}
+
+	free(row);
+	if(fclose(file) != 0 || result)
+	{
+		SDL_Log("Failed to write %s", path);
+		return 1;
+	}
+	return 0;
+}
+
+int boid_raster_init(int width, int height)
+{
+	if(width <= 0 || height <= 0) return 1;
+
+	boid_raster.width = width;
+	boid_raster.height = height;
+	boid_raster.pixels = malloc((size_t)width * height * sizeof(uint32_t));
+	boid_raster_tiles_w = (width + BOID_RASTER_TILE - 1) / BOID_RASTER_TILE;
+	boid_raster_tiles_h = (height + BOID_RASTER_TILE - 1) / BOID_RASTER_TILE;
+	boid_raster_tile_start = malloc(((size_t)boid_raster_tiles_w * boid_raster_tiles_h + 1) * sizeof(uint32_t));
+	if(boid_raster.pixels == NULL || boid_raster_tile_start == NULL)
+	{
+		boid_raster_terminate();
+		return 2;
+	}
+
+	// the calling thread draws tiles as well
+	boid_raster_quit = 0;
+	boid_raster_thread_count = 0;
+	boid_raster_start = SDL_CreateSemaphore(0);
+	boid_raster_done = SDL_CreateSemaphore(0);
+	int threads = boid_raster_min(SDL_GetCPUCount() - 1, BOID_RASTER_MAX_THREADS);
+	for(int i = 0; i < threads && boid_raster_start != NULL && boid_raster_done != NULL; ++i)
+	{
+		if((boid_raster_threads[i] = SDL_CreateThread(&boid_raster_thread, "raster", NULL)) == NULL)
+			break;
+		++boid_raster_thread_count;
+	}
+
+	return 0;
+}
+
+void boid_raster_terminate(void)
+{
+	__atomic_store_n(&boid_raster_quit, 1, __ATOMIC_RELEASE);
+	for(int i = 0; i < boid_raster_thread_count; ++i)
+		SDL_SemPost(boid_raster_start);
+	for(int i = 0; i < boid_raster_thread_count; ++i)
+		SDL_WaitThread(boid_raster_threads[i], NULL);
+	boid_raster_thread_count = 0;
+
+	if(boid_raster_start != NULL) SDL_DestroySemaphore(boid_raster_start);
+	if(boid_raster_done != NULL) SDL_DestroySemaphore(boid_raster_done);
+	boid_raster_start = boid_raster_done = NULL;
+
+	free(boid_raster.pixels);
+	free(boid_raster_cells);
+	free(boid_raster_tile_start);
+	free(boid_raster_tile_boids);
+	memset(&boid_raster, 0, sizeof(boid_raster_t));
+	boid_raster_cells = NULL;
+	boid_raster_tile_start = boid_raster_tile_boids = NULL;
+	boid_raster_cell_capacity = boid_raster_tile_capacity = 0;
+}
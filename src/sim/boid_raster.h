@@ -0,0 +1,48 @@
+//
+//  boid_raster.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef boid_raster_h
+#define boid_raster_h
+
+#include <stdint.h>
+#include "boid_snapshot.h"
+
+// side of the square tiles the framebuffer is split into, each tile is drawn by one thread
+#define BOID_RASTER_TILE (64)
+#define BOID_RASTER_MAX_THREADS (16)
+
+// cpu side image of boids, drawn the way draw_boids draws them without a renderer
+typedef struct boid_raster_t {
+	int width, height;
+	uint32_t* pixels; // argb8888
+} boid_raster_t;
+
+extern boid_raster_t boid_raster;
+// steps between written frames
+extern int boid_raster_interval;
+// printf pattern of the frame files taking the frame number as an int, written as png when it ends in .png and as ppm otherwise
+extern const char* boid_raster_path;
+
+/**
+ * \brief Allocates the framebuffer and starts the threads drawing tiles.
+ * \returns 0 on success.
+ */
+extern int boid_raster_init(int width, int height);
+extern void boid_raster_terminate(void);
+
+/**
+ * \brief Draws the density map, boids and obstacles of a snapshot into boid_raster.
+ */
+extern void boid_raster_draw(boid_snapshot_t* snapshot);
+
+/**
+ * \brief Writes boid_raster to path as png or ppm depending on its extension.
+ * \returns 0 on success.
+ */
+extern int boid_raster_write(const char* path);
+
+#endif /* boid_raster_h */
@@ -0,0 +1,61 @@
+//
+//  boid_schedule.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "boid_schedule.h"
+#include "boid_c.h"
+#include "boid_aggregate.h"
+#include "boid_domain.h"
+#include "boid_grid.h"
+#include "obstacle.h"
+
+// systems whose thread count is tuned at runtime
+TUNE_SYSTEM(system_boid_update_position)
+TUNE_SYSTEM(system_boids_wall_avoid)
+TUNE_SYSTEM(system_boids_cohesion)
+TUNE_SYSTEM(system_boids_alignment)
+TUNE_SYSTEM(system_boids_separation)
+// single threaded systems that are only measured
+TUNE_SYSTEM(system_boids_sort)
+TUNE_SYSTEM(system_boid_grid_build)
+TUNE_SYSTEM(system_boid_aggregate_build)
+TUNE_SYSTEM(system_boid_update_near)
+TUNE_SYSTEM(system_obstacles_bake)
+
+tune_system_t* boid_schedule_tuned[] = {
+	&system_boid_update_position_tune,
+	&system_boids_sort_tune,
+	&system_boid_grid_build_tune,
+	&system_boid_aggregate_build_tune,
+	&system_boid_update_near_tune,
+	&system_obstacles_bake_tune,
+	&system_boids_wall_avoid_tune,
+	&system_boids_cohesion_tune,
+	&system_boids_alignment_tune,
+	&system_boids_separation_tune,
+};
+const size_t boid_schedule_tuned_count = sizeof(boid_schedule_tuned) / sizeof(tune_system_t*);
+
+void boid_schedule_init(int arena_flags)
+{
+	// register boid_c as a component type
+	boid_component = ecsRegisterComponent(boid_c);
+	boid_component_size = sizeof(boid_c);
+	
+	tuneEnableSystem(system_boid_update_position, boid_component, ECS_QUERY_ALL, 8, 50);
+	ecsEnableSystem(&system_boids_wrap, boid_component, ECS_QUERY_ALL, 0, 55);
+	tuneEnableSystem(system_boids_sort, boid_component, ECS_QUERY_ALL, 0, 90);
+	ecsEnableSystem(&system_boid_domain_exchange, boid_component, ECS_QUERY_ALL, 0, 95);
+	boid_grid_init(arena_flags);
+	tuneEnableSystem(system_boid_grid_build, boid_component, ECS_QUERY_ALL, 0, 96);
+	tuneEnableSystem(system_boid_aggregate_build, nocomponent, ECS_NOQUERY, 0, 97);
+	tuneEnableSystem(system_boid_update_near, boid_component, ECS_QUERY_ALL, 0, 100);
+	tuneEnableSystem(system_obstacles_bake, nocomponent, ECS_NOQUERY, 0, 290);
+	tuneEnableSystem(system_boids_wall_avoid, boid_component, ECS_QUERY_ALL, 8, 300);
+	tuneEnableSystem(system_boids_cohesion, boid_component, ECS_QUERY_ALL, 8, 400);
+	tuneEnableSystem(system_boids_alignment, boid_component, ECS_QUERY_ALL, 8, 410);
+	tuneEnableSystem(system_boids_separation, boid_component, ECS_QUERY_ALL, 8, 420);
+}
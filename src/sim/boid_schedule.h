@@ -0,0 +1,25 @@
+//
+//  boid_schedule.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef boid_schedule_h
+#define boid_schedule_h
+
+#include <stddef.h>
+#include <tune.h>
+
+// the tuned systems of the schedule in execution order, for reporting their timings
+extern tune_system_t* boid_schedule_tuned[];
+extern const size_t boid_schedule_tuned_count;
+
+/**
+ * \brief Registers boid_c and enables every system that steps the boids, in the order and with the thread counts the sim runs them.
+ * \param arena_flags Passed on to boid_grid_init.
+ * \note Systems that talk to the gui, the renderer or other tools are left to the caller.
+ */
+extern void boid_schedule_init(int arena_flags);
+
+#endif /* boid_schedule_h */
@@ -0,0 +1,73 @@
+//
+//  boid_snapshot.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "boid_snapshot.h"
+#include "boid_c.h"
+#include <assert.h>
+#include <string.h>
+
+boid_snapshot_t boid_snapshot_slots[3];
+triple_buffer_t boid_snapshots;
+arena_t boid_snapshot_arena;
+
+size_t boid_snapshot_step = 0;
+
+void boid_snapshot_init(int arena_flags)
+{
+	arenaInit(&boid_snapshot_arena, "boid snapshot", arena_flags, 2 << 20);
+	memset(boid_snapshot_slots, 0, sizeof(boid_snapshot_slots));
+	triple_buffer_init(&boid_snapshots, &boid_snapshot_slots[0], &boid_snapshot_slots[1], &boid_snapshot_slots[2]);
+	boid_snapshot_step = 0;
+}
+
+void boid_snapshot_terminate(void)
+{
+	arenaTerminate(&boid_snapshot_arena);
+	memset(boid_snapshot_slots, 0, sizeof(boid_snapshot_slots));
+}
+
+void system_boid_snapshot(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	boid_snapshot_t* snapshot = triple_buffer_back(&boid_snapshots);
+	boid_c* boid;
+
+	if(count > snapshot->capacity)
+	{
+		snapshot->position = arenaRealloc(&boid_snapshot_arena, snapshot->position,
+										  snapshot->capacity * sizeof(fvec), count * sizeof(fvec));
+		snapshot->velocity = arenaRealloc(&boid_snapshot_arena, snapshot->velocity,
+										  snapshot->capacity * sizeof(fvec), count * sizeof(fvec));
+		snapshot->capacity = count;
+		assert(snapshot->position != NULL && snapshot->velocity != NULL);
+	}
+
+	// halo copies are drawn by the process owning them
+	snapshot->count = 0;
+	for(size_t i = 0; i < count; ++i)
+	{
+		boid = ecsGetComponentPtr(entities[i], boid_component);
+		if(boid->ownership != BOID_OWNED) continue;
+
+		snapshot->position[snapshot->count] = boid->position;
+		snapshot->velocity[snapshot->count] = boid->velocity;
+		++snapshot->count;
+	}
+
+	if(obstacles_last > snapshot->obstacle_capacity)
+	{
+		snapshot->obstacles = arenaRealloc(&boid_snapshot_arena, snapshot->obstacles,
+										   snapshot->obstacle_capacity * sizeof(obstacle_t), obstacles_last * sizeof(obstacle_t));
+		snapshot->obstacle_capacity = obstacles_last;
+		assert(snapshot->obstacles != NULL);
+	}
+	if(obstacles_last > 0)
+		memcpy(snapshot->obstacles, obstacles_first, obstacles_last * sizeof(obstacle_t));
+	snapshot->obstacle_count = obstacles_last;
+
+	snapshot->step = ++boid_snapshot_step;
+	triple_buffer_publish(&boid_snapshots);
+}
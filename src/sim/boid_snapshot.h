@@ -0,0 +1,37 @@
+//
+//  boid_snapshot.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef boid_snapshot_h
+#define boid_snapshot_h
+
+#include <ecs.h>
+#include <vec.h>
+#include <arena.h>
+#include <triple_buffer.h>
+#include "obstacle.h"
+
+// everything the render thread draws, copied out of the sim at the end of a step
+typedef struct boid_snapshot_t {
+	size_t step;
+	size_t count, capacity;
+	fvec* position;
+	fvec* velocity;
+	obstacle_t* obstacles;
+	size_t obstacle_count, obstacle_capacity;
+} boid_snapshot_t;
+
+// written by system_boid_snapshot on the sim thread, read with triple_buffer_acquire on the render thread
+extern triple_buffer_t boid_snapshots;
+// backs the arrays of all three snapshots
+extern arena_t boid_snapshot_arena;
+
+extern void boid_snapshot_init(int arena_flags);
+extern void boid_snapshot_terminate(void);
+
+extern void system_boid_snapshot(ecsEntityId*, ecsComponentMask*, size_t, float);
+
+#endif /* boid_snapshot_h */
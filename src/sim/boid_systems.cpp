@@ -0,0 +1,207 @@
+//
+//  boid_systems.cpp
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+// boid systems written as typed kernels, each writes only the boid it runs for and reads its neighbours
+
+#include <ecs_system.hpp>
+
+extern "C" {
+#include "boid_c.h"
+#include "boid_aggregate.h"
+#include "obstacle.h"
+}
+
+template<> struct ecs::component<boid_c> {
+	static ecsComponentMask mask() { return boid_component; }
+	static size_t size() { return boid_component_size; }
+};
+
+struct boid_update_position {
+	float delta_time, acceleration, max_velocity;
+
+	boid_update_position(float delta_time)
+	: delta_time(delta_time), acceleration(boid_acceleration * delta_time), max_velocity(boid_max_velocity) {}
+
+	void operator()(boid_c& boid) const
+	{
+		fvec force, velocity;
+
+		// copies of other processes' boids are moved by their owner
+		if(boid.ownership != BOID_OWNED)
+		{
+			boid.force = fvec{ 0.f, 0.f };
+			return;
+		}
+
+		force = boid.force;
+		vmulf(&force, &force, max_velocity);
+		vmax(&force, &force, max_velocity);
+		vmovetowards(&boid.velocity, &boid.velocity, &force, acceleration);
+
+		assert(!isnan(boid.position.x) && !isnan(boid.position.y));
+		assert(!isnan(boid.velocity.x) && !isnan(boid.velocity.y));
+
+		boid.force = fvec{ 0.f, 0.f };
+
+		vmulf(&velocity, &boid.velocity, delta_time);
+		vadd(&boid.position, &boid.position, &velocity);
+	}
+};
+
+// steer away from the walls of boid_available_area and from obstacles using the baked distance field
+struct boid_wall_avoid {
+	behaviour_t behaviour;
+
+	boid_wall_avoid(float delta_time) : behaviour(wall_avoid) {}
+
+	void operator()(boid_c& boid) const
+	{
+		fvec force;
+		float dist = obstacle_sample(&boid.position, &force);
+
+		if(dist < behaviour.range)
+		{
+			vmulf(&force, &force, behaviour.force);
+			vadd(&boid.force, &boid.force, &force);
+		}
+	}
+};
+
+// running mean over the first end entries of the neighbour list of boid
+template<bool Velocity>
+static inline fvec boid_near_mean(const boid_c& boid, size_t end, fvec avrg)
+{
+	fvec diff, value;
+	const boid_c* other;
+	
+	for(size_t j = 0; j < end; ++j)
+	{
+		other = ecs::get<const boid_c>(boid.near[j]);
+		if constexpr(Velocity)
+		{
+			value = other->velocity;
+		}
+		else
+		{
+			value = other->position;
+			if(boid_periodic) boid_nearest_image(&value, &boid.position);
+		}
+		vsub(&diff, &value, &avrg);
+		vmulf(&diff, &diff, 1.f/(j + 1));
+		vadd(&avrg, &avrg, &diff);
+		assert(!isnan(avrg.x) && !isnan(avrg.y));
+	}
+	return avrg;
+}
+
+// steer towards the mean position of the neighbours within range,
+// approximated from the aggregate grid instead of the neighbour list when theta is set
+struct boid_cohesion {
+	float force, range, theta;
+	size_t nearest;
+	
+	boid_cohesion(float delta_time)
+	: force(cohesion.force), range(cohesion.range), theta(boid_aggregate.theta), nearest(behaviour_nearest(&cohesion)) {}
+	
+	void operator()(boid_c& boid) const
+	{
+		fvec avrg{ 0.f, 0.f }, steer;
+		size_t end;
+		
+		// halo boids are steered by their owner and have empty neighbour lists here
+		if(boid.ownership != BOID_OWNED) return;
+		
+		if(theta > 0.f)
+		{
+			boid_aggregate_mean(&boid.position, range, theta, &avrg);
+		}
+		else
+		{
+			// the list is sorted by distance, so the neighbours in range are the ones before the cut
+			end = boid.near_cut[BOID_NEAR_COHESION] < nearest ? boid.near_cut[BOID_NEAR_COHESION] : nearest;
+			avrg = boid_near_mean<false>(boid, end, avrg);
+		}
+		
+		vsub(&steer, &avrg, &boid.position);
+		vmulf(&steer, &steer, force);
+		vadd(&boid.force, &boid.force, &steer);
+		assert(!isnan(boid.force.x) && !isnan(boid.force.y));
+	}
+};
+
+// steer away from the mean position of the neighbours within range
+struct boid_separation {
+	float force;
+	size_t nearest;
+	
+	boid_separation(float delta_time) : force(separation.force), nearest(behaviour_nearest(&separation)) {}
+	
+	void operator()(boid_c& boid) const
+	{
+		fvec avrg, steer;
+		size_t end;
+		
+		if(boid.ownership != BOID_OWNED) return;
+		
+		end = boid.near_cut[BOID_NEAR_SEPARATION] < nearest ? boid.near_cut[BOID_NEAR_SEPARATION] : nearest;
+		avrg = boid_near_mean<false>(boid, end, fvec{ 0.f, 0.f });
+		
+		vsub(&steer, &avrg, &boid.position);
+		vmulf(&steer, &steer, force);
+		vsub(&boid.force, &boid.force, &steer);
+		assert(!isnan(boid.force.x) && !isnan(boid.force.y));
+	}
+};
+
+// steer along the mean velocity of the neighbours within range
+struct boid_alignment {
+	float force;
+	size_t nearest;
+	
+	boid_alignment(float delta_time) : force(alignment.force), nearest(behaviour_nearest(&alignment)) {}
+	
+	void operator()(boid_c& boid) const
+	{
+		fvec avrg;
+		size_t end;
+		
+		if(boid.ownership != BOID_OWNED) return;
+		
+		end = boid.near_cut[BOID_NEAR_ALIGNMENT] < nearest ? boid.near_cut[BOID_NEAR_ALIGNMENT] : nearest;
+		avrg = boid_near_mean<true>(boid, end, fvec{ 0.f, 0.f });
+		
+		vmulf(&avrg, &avrg, force);
+		vadd(&boid.force, &boid.force, &avrg);
+		assert(!isnan(boid.force.x) && !isnan(boid.force.y));
+	}
+};
+
+extern "C" void system_boid_update_position(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	ecs::each<boid_update_position, boid_c>(entities, components, count, delta_time);
+}
+
+extern "C" void system_boids_wall_avoid(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	if(wall_avoid.force == 0.f) return;
+	ecs::each<boid_wall_avoid, boid_c>(entities, components, count, delta_time);
+}
+
+extern "C" void system_boids_cohesion(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	ecs::each<boid_cohesion, boid_c>(entities, components, count, delta_time);
+}
+
+extern "C" void system_boids_separation(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	ecs::each<boid_separation, boid_c>(entities, components, count, delta_time);
+}
+
+extern "C" void system_boids_alignment(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	ecs::each<boid_alignment, boid_c>(entities, components, count, delta_time);
+}
@@ -0,0 +1,405 @@
+//
+//  obstacle.c
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#include "obstacle.h"
+#include "boid_c.h"
+#include <SDL2/SDL.h>
+#include <engine.h>
+#include <assert.h>
+
+#define OBSTACLE_CIRCLE_SEGMENTS (24)
+
+typedef struct obstacle_field_t {
+	float distance;
+	fvec gradient;
+} obstacle_field_t;
+
+float obstacle_cell_size = 8.f;
+
+obstacle_t* obstacles_first;
+size_t obstacles_last;
+size_t obstacles_size;
+
+obstacle_field_t* obstacle_field;
+int obstacle_field_w, obstacle_field_h;
+fvec obstacle_field_origin;
+
+// the arena and range the field was last baked for
+SDL_Rect obstacle_baked_arena;
+float obstacle_baked_range;
+short obstacle_baked_periodic;
+
+// area of the field waiting to be rebaked, in field samples
+short obstacle_dirty;
+int obstacle_dirty_x0, obstacle_dirty_y0, obstacle_dirty_x1, obstacle_dirty_y1;
+
+
+//
+// SIGNED DISTANCES
+//
+
+// distance to the walls of the arena, positive inside
+static float arena_distance(fvec* p, SDL_Rect* arena, fvec* gradient)
+{
+	// a periodic arena has no walls
+	if(obstacle_baked_periodic)
+	{
+		*gradient = (fvec){ 0.f, 0.f };
+		return INFINITY;
+	}
+
+	float left = p->x - arena->x, right = arena->x + arena->w - p->x;
+	float top = p->y - arena->y, bottom = arena->y + arena->h - p->y;
+	float d = left;
+	*gradient = VRIGHT;
+
+	if(right < d) { d = right; *gradient = VLEFT; }
+	if(top < d) { d = top; *gradient = (fvec){ 0.f, 1.f }; }
+	if(bottom < d) { d = bottom; *gradient = (fvec){ 0.f, -1.f }; }
+
+	return d;
+}
+
+static float obstacle_distance(obstacle_t* obstacle, fvec* p, fvec* gradient)
+{
+	fvec diff, q;
+	float d;
+
+	vsub(&diff, p, &obstacle->centre);
+
+	switch(obstacle->shape)
+	{
+	case OBSTACLE_CIRCLE:
+		d = vmag(&diff);
+		if(d == 0.f)
+			*gradient = VUP;
+		else
+			vmulf(gradient, &diff, 1.f/d);
+		return d - obstacle->extents.x;
+	case OBSTACLE_RECT:
+	default:
+		vabs(&q, &diff);
+		vsub(&q, &q, &obstacle->extents);
+		if(q.x > 0.f || q.y > 0.f)
+		{
+			// outside, move away from the closest point on the edge
+			*gradient = (fvec){
+				q.x > 0.f ? copysignf(q.x, diff.x) : 0.f,
+				q.y > 0.f ? copysignf(q.y, diff.y) : 0.f
+			};
+			d = vmag(gradient);
+			vmulf(gradient, gradient, 1.f/d);
+			return d;
+		}
+		// inside, leave through the closest side
+		if(q.x > q.y)
+		{
+			*gradient = (fvec){ copysignf(1.f, diff.x), 0.f };
+			return q.x;
+		}
+		*gradient = (fvec){ 0.f, copysignf(1.f, diff.y) };
+		return q.y;
+	}
+}
+
+// bounds of the area an obstacle influences, in field samples
+static void obstacle_influence(obstacle_t* obstacle, int* x0, int* y0, int* x1, int* y1)
+{
+	fvec extents = obstacle->extents;
+	if(obstacle->shape == OBSTACLE_CIRCLE)
+		extents.y = extents.x;
+
+	float range = obstacle_baked_range;
+	*x0 = (int)floorf((obstacle->centre.x - extents.x - range - obstacle_field_origin.x) / obstacle_cell_size);
+	*y0 = (int)floorf((obstacle->centre.y - extents.y - range - obstacle_field_origin.y) / obstacle_cell_size);
+	*x1 = (int)ceilf((obstacle->centre.x + extents.x + range - obstacle_field_origin.x) / obstacle_cell_size);
+	*y1 = (int)ceilf((obstacle->centre.y + extents.y + range - obstacle_field_origin.y) / obstacle_cell_size);
+}
+
+
+//
+// BAKING
+//
+
+static void obstacle_mark_dirty(int x0, int y0, int x1, int y1)
+{
+	if(obstacle_dirty)
+	{
+		x0 = x0 < obstacle_dirty_x0 ? x0 : obstacle_dirty_x0;
+		y0 = y0 < obstacle_dirty_y0 ? y0 : obstacle_dirty_y0;
+		x1 = x1 > obstacle_dirty_x1 ? x1 : obstacle_dirty_x1;
+		y1 = y1 > obstacle_dirty_y1 ? y1 : obstacle_dirty_y1;
+	}
+
+	obstacle_dirty_x0 = x0; obstacle_dirty_y0 = y0;
+	obstacle_dirty_x1 = x1; obstacle_dirty_y1 = y1;
+	obstacle_dirty = 1;
+}
+
+static void obstacle_mark_obstacle_dirty(obstacle_t* obstacle)
+{
+	int x0, y0, x1, y1;
+	if(obstacle_field == NULL) return;
+	obstacle_influence(obstacle, &x0, &y0, &x1, &y1);
+	obstacle_mark_dirty(x0, y0, x1, y1);
+}
+
+// recompute the field within [x0,x1]x[y0,y1] from the arena and every obstacle influencing the area
+static void obstacle_bake_area(int x0, int y0, int x1, int y1)
+{
+	int ox0, oy0, ox1, oy1;
+	obstacle_field_t* sample;
+	obstacle_t* obstacle;
+	fvec p, gradient;
+	float d;
+
+	x0 = x0 < 0 ? 0 : x0;
+	y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 >= obstacle_field_w ? obstacle_field_w - 1 : x1;
+	y1 = y1 >= obstacle_field_h ? obstacle_field_h - 1 : y1;
+
+	for(int y = y0; y <= y1; ++y)
+	{
+		for(int x = x0; x <= x1; ++x)
+		{
+			sample = &obstacle_field[(size_t)y * obstacle_field_w + x];
+			p = (fvec){
+				obstacle_field_origin.x + x * obstacle_cell_size,
+				obstacle_field_origin.y + y * obstacle_cell_size
+			};
+			sample->distance = arena_distance(&p, &obstacle_baked_arena, &sample->gradient);
+		}
+	}
+
+	for(size_t i = 0; i < obstacles_last; ++i)
+	{
+		obstacle = &obstacles_first[i];
+		if(!obstacle->active) continue;
+
+		obstacle_influence(obstacle, &ox0, &oy0, &ox1, &oy1);
+		ox0 = ox0 > x0 ? ox0 : x0;
+		oy0 = oy0 > y0 ? oy0 : y0;
+		ox1 = ox1 < x1 ? ox1 : x1;
+		oy1 = oy1 < y1 ? oy1 : y1;
+
+		for(int y = oy0; y <= oy1; ++y)
+		{
+			for(int x = ox0; x <= ox1; ++x)
+			{
+				sample = &obstacle_field[(size_t)y * obstacle_field_w + x];
+				p = (fvec){
+					obstacle_field_origin.x + x * obstacle_cell_size,
+					obstacle_field_origin.y + y * obstacle_cell_size
+				};
+				d = obstacle_distance(obstacle, &p, &gradient);
+				if(d < sample->distance)
+				{
+					sample->distance = d;
+					sample->gradient = gradient;
+				}
+			}
+		}
+	}
+
+	// anything past the range produces no force, clamping keeps partial rebakes consistent with full ones
+	for(int y = y0; y <= y1; ++y)
+	{
+		for(int x = x0; x <= x1; ++x)
+		{
+			sample = &obstacle_field[(size_t)y * obstacle_field_w + x];
+			if(sample->distance > obstacle_baked_range)
+				sample->distance = obstacle_baked_range;
+		}
+	}
+}
+
+// reallocate the field to cover the arena and its surroundings and bake all of it
+static void obstacle_bake_all(SDL_Rect* arena, float range)
+{
+	float margin = range + obstacle_cell_size;
+
+	obstacle_baked_arena = *arena;
+	obstacle_baked_range = range;
+	obstacle_baked_periodic = boid_periodic;
+	obstacle_field_origin = (fvec){ arena->x - margin, arena->y - margin };
+	obstacle_field_w = (int)ceilf((arena->w + margin * 2.f) / obstacle_cell_size) + 1;
+	obstacle_field_h = (int)ceilf((arena->h + margin * 2.f) / obstacle_cell_size) + 1;
+
+	obstacle_field = realloc(obstacle_field, (size_t)obstacle_field_w * obstacle_field_h * sizeof(obstacle_field_t));
+	assert(obstacle_field != NULL);
+
+	obstacle_bake_area(0, 0, obstacle_field_w - 1, obstacle_field_h - 1);
+	obstacle_dirty = 0;
+}
+
+void system_obstacles_bake(ecsEntityId* entities, ecsComponentMask* components, size_t count, float delta_time)
+{
+	if(obstacle_field == NULL
+	   || memcmp(&obstacle_baked_arena, &boid_available_area, sizeof(SDL_Rect)) != 0
+	   || obstacle_baked_range != wall_avoid.range
+	   || obstacle_baked_periodic != boid_periodic)
+	{
+		obstacle_bake_all(&boid_available_area, wall_avoid.range);
+	}
+	else if(obstacle_dirty)
+	{
+		obstacle_bake_area(obstacle_dirty_x0, obstacle_dirty_y0, obstacle_dirty_x1, obstacle_dirty_y1);
+		obstacle_dirty = 0;
+	}
+}
+
+float obstacle_sample(fvec* position, fvec* gradient)
+{
+	if(obstacle_field == NULL)
+	{
+		*gradient = (fvec){ 0.f, 0.f };
+		return INFINITY;
+	}
+
+	// positions outside the field use its closest edge
+	float gx = (position->x - obstacle_field_origin.x) / obstacle_cell_size;
+	float gy = (position->y - obstacle_field_origin.y) / obstacle_cell_size;
+	gx = gx < 0.f ? 0.f : gx > obstacle_field_w - 1.001f ? obstacle_field_w - 1.001f : gx;
+	gy = gy < 0.f ? 0.f : gy > obstacle_field_h - 1.001f ? obstacle_field_h - 1.001f : gy;
+
+	int x = (int)gx, y = (int)gy;
+	float fx = gx - x, fy = gy - y;
+	obstacle_field_t* s00 = &obstacle_field[(size_t)y * obstacle_field_w + x];
+	obstacle_field_t* s10 = s00 + 1;
+	obstacle_field_t* s01 = s00 + obstacle_field_w;
+	obstacle_field_t* s11 = s01 + 1;
+
+	float w00 = (1.f - fx) * (1.f - fy), w10 = fx * (1.f - fy);
+	float w01 = (1.f - fx) * fy, w11 = fx * fy;
+
+	gradient->x = s00->gradient.x * w00 + s10->gradient.x * w10 + s01->gradient.x * w01 + s11->gradient.x * w11;
+	gradient->y = s00->gradient.y * w00 + s10->gradient.y * w10 + s01->gradient.y * w01 + s11->gradient.y * w11;
+	vnor(gradient, gradient);
+
+	return s00->distance * w00 + s10->distance * w10 + s01->distance * w01 + s11->distance * w11;
+}
+
+
+//
+// OBSTACLES
+//
+
+static int obstacle_add(obstacle_t obstacle)
+{
+	size_t index = 0;
+
+	// reuse removed slots before growing
+	while(index < obstacles_last && obstacles_first[index].active)
+		++index;
+
+	if(index == obstacles_last)
+	{
+		if(obstacles_last >= obstacles_size)
+		{
+			obstacles_size = obstacles_size == 0 ? 16 : obstacles_size * 2;
+			obstacle_t* first = realloc(obstacles_first, obstacles_size * sizeof(obstacle_t));
+			if(first == NULL)
+				return -1;
+			obstacles_first = first;
+		}
+		++obstacles_last;
+	}
+
+	obstacle.active = 1;
+	obstacles_first[index] = obstacle;
+	obstacle_mark_obstacle_dirty(&obstacles_first[index]);
+	return (int)index;
+}
+
+int obstacle_add_circle(fvec centre, float radius)
+{
+	return obstacle_add((obstacle_t){
+		.shape = OBSTACLE_CIRCLE,
+		.centre = centre,
+		.extents = { radius, radius }
+	});
+}
+
+int obstacle_add_rect(fvec centre, fvec half_size)
+{
+	return obstacle_add((obstacle_t){
+		.shape = OBSTACLE_RECT,
+		.centre = centre,
+		.extents = half_size
+	});
+}
+
+void obstacle_move(int handle, fvec centre)
+{
+	assert(handle >= 0 && (size_t)handle < obstacles_last);
+	obstacle_t* obstacle = &obstacles_first[handle];
+
+	// rebake both where the obstacle was and where it is now
+	obstacle_mark_obstacle_dirty(obstacle);
+	obstacle->centre = centre;
+	obstacle_mark_obstacle_dirty(obstacle);
+}
+
+void obstacle_remove(int handle)
+{
+	assert(handle >= 0 && (size_t)handle < obstacles_last);
+	obstacle_t* obstacle = &obstacles_first[handle];
+
+	obstacle_mark_obstacle_dirty(obstacle);
+	obstacle->active = 0;
+}
+
+void obstacle_clear(void)
+{
+	obstacles_last = 0;
+	if(obstacle_field != NULL)
+		obstacle_mark_dirty(0, 0, obstacle_field_w - 1, obstacle_field_h - 1);
+}
+
+void obstacle_terminate(void)
+{
+	free(obstacles_first);
+	free(obstacle_field);
+	obstacles_first = NULL;
+	obstacle_field = NULL;
+	obstacles_last = obstacles_size = 0;
+	obstacle_dirty = 0;
+}
+
+void draw_obstacles(obstacle_t* obstacles, size_t count)
+{
+	SDL_FPoint points[OBSTACLE_CIRCLE_SEGMENTS + 1];
+	obstacle_t* obstacle;
+
+	SDL_SetRenderDrawColor(renderer, 200, 60, 60, 255);
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		obstacle = &obstacles[i];
+		if(!obstacle->active) continue;
+
+		if(obstacle->shape == OBSTACLE_CIRCLE)
+		{
+			for(int j = 0; j <= OBSTACLE_CIRCLE_SEGMENTS; ++j)
+			{
+				float angle = (float)j / OBSTACLE_CIRCLE_SEGMENTS * 2.f * (float)M_PI;
+				points[j] = (SDL_FPoint){
+					obstacle->centre.x + cosf(angle) * obstacle->extents.x,
+					obstacle->centre.y + sinf(angle) * obstacle->extents.x
+				};
+			}
+			SDL_RenderDrawLinesF(renderer, points, OBSTACLE_CIRCLE_SEGMENTS + 1);
+		}
+		else
+		{
+			SDL_RenderDrawRectF(renderer, &(SDL_FRect){
+				obstacle->centre.x - obstacle->extents.x, obstacle->centre.y - obstacle->extents.y,
+				obstacle->extents.x * 2.f, obstacle->extents.y * 2.f
+			});
+		}
+	}
+}
@@ -0,0 +1,67 @@
+//
+//  obstacle.h
+//  sim
+//
+//  Created by Scott on 19/10/2026.
+//
+
+#ifndef obstacle_h
+#define obstacle_h
+
+#include <ecs.h>
+#include <vec.h>
+
+struct SDL_Rect;
+
+typedef enum obstacle_shape_t {
+	OBSTACLE_CIRCLE = 0x0,
+	OBSTACLE_RECT,
+} obstacle_shape_t;
+
+typedef struct obstacle_t {
+	obstacle_shape_t shape;
+	fvec centre;
+	fvec extents; // radius in x for circles, half width and height for rectangles
+	short active;
+} obstacle_t;
+
+// distance between samples of the baked distance field in pixels
+extern float obstacle_cell_size;
+
+// obstacles by handle, inactive entries are free
+extern obstacle_t* obstacles_first;
+extern size_t obstacles_last;
+
+/**
+ * \brief Adds an obstacle to the distance field.
+ * \returns A handle used to move or remove the obstacle.
+ * \returns -1 if allocation failed.
+ */
+extern int obstacle_add_circle(fvec centre, float radius);
+extern int obstacle_add_rect(fvec centre, fvec half_size);
+
+/**
+ * \brief Moves an obstacle, only the area it left and the area it entered are rebaked.
+ */
+extern void obstacle_move(int handle, fvec centre);
+extern void obstacle_remove(int handle);
+extern void obstacle_clear(void);
+extern void obstacle_terminate(void);
+
+/**
+ * \brief Samples the baked distance field.
+ * \param position The point to sample.
+ * \param gradient Receives the normalized direction away from the closest obstacle or wall.
+ * \returns The signed distance to the closest obstacle or wall, negative when inside one.
+ * \note Distances further than wall_avoid.range from everything are reported as wall_avoid.range.
+ */
+extern float obstacle_sample(fvec* position, fvec* gradient);
+
+/**
+ * \brief Draws the outlines of obstacles, call from the render thread.
+ */
+extern void draw_obstacles(obstacle_t* obstacles, size_t count);
+
+extern void system_obstacles_bake(ecsEntityId*, ecsComponentMask*, size_t, float);
+
+#endif /* obstacle_h */
@@ -1,73 +1,264 @@
 #include <SDL2/SDL.h>
+#include <stdio.h>
 #include <ecs.h>
 #include <engine.h>
 #include <adb.h>
 #include <ui.h>
+#include <tune.h>
+#include <arena.h>
 
-#define BOID_NEAR_COUNT (200)
 #include "boid_c.h"
+#include "boid_aggregate.h"
+#include "boid_domain.h"
+#include "boid_grid.h"
+#include "boid_publish.h"
+#include "boid_raster.h"
+#include "boid_schedule.h"
+#include "boid_snapshot.h"
+#include "obstacle.h"
 
 int boid_spawn_num;
 
-void system_draw_gui(ecsEntityId* entities, ecsComponentMask* mask, size_t count, float delta_time)
+int domain_rank, domain_count;
+// the arena every process of a distributed run splits into strips, the same for all of them whatever their window
+SDL_Rect domain_world;
+const char* domain_socket_dir;
+const char* publish_name;
+uint32_t publish_capacity;
+int arena_flags;
+
+// parameters the gui edits
+typedef struct sim_params_t {
+	float max_velocity;
+	float acceleration;
+	behaviour_t alignment;
+	behaviour_t cohesion;
+	behaviour_t separation;
+	behaviour_t mouse_interact;
+	float aggregate_theta;
+	float near_skin;
+} sim_params_t;
+
+// measurements the gui shows
+typedef struct sim_stats_t {
+	float aggregate_mean_error;
+	float aggregate_max_error;
+	float sort_gain;
+} sim_stats_t;
+
+// area left free by the gui and the parameters set in it, handed from the render thread to the sim thread,
+// and the measurements of the last step handed back
+SDL_SpinLock ui_area_lock;
+SDL_Rect ui_area;
+sim_params_t ui_params;
+sim_stats_t ui_stats;
+// the copy the sliders write to, only touched by the render thread
+sim_params_t gui_params;
+// slider values of the behaviours' neighbour caps, indexed by boid_near_cut_t
+float gui_nearest[BOID_NEAR_CUTS];
+
+static sim_params_t sim_params_current(void)
+{
+	return (sim_params_t){
+		.max_velocity = boid_max_velocity,
+		.acceleration = boid_acceleration,
+		.alignment = alignment,
+		.cohesion = cohesion,
+		.separation = separation,
+		.mouse_interact = mouse_interact,
+		.aggregate_theta = boid_aggregate_theta,
+		.near_skin = boid_near_skin
+	};
+}
+
+// picks up the area the gui left free and its parameters at the start of a step, so they stay the same for the whole step
+void system_apply_ui_area(ecsEntityId* entities, ecsComponentMask* mask, size_t count, float delta_time)
+{
+	sim_params_t params;
+	sim_stats_t stats = {
+		.aggregate_mean_error = boid_aggregate_mean_error,
+		.aggregate_max_error = boid_aggregate_max_error,
+		.sort_gain = boid_sort_gain
+	};
+	
+	SDL_AtomicLock(&ui_area_lock);
+	// the strips of a distributed run are cut from a fixed world, a gui panel of one process must not move its walls
+	if(boid_domain_count <= 1)
+		boid_available_area = ui_area;
+	params = ui_params;
+	ui_stats = stats;
+	SDL_AtomicUnlock(&ui_area_lock);
+	
+	boid_max_velocity = params.max_velocity;
+	boid_acceleration = params.acceleration;
+	alignment = params.alignment;
+	cohesion = params.cohesion;
+	separation = params.separation;
+	mouse_interact = params.mouse_interact;
+	boid_aggregate_theta = params.aggregate_theta;
+	boid_near_skin = params.near_skin;
+	// the neighbour lists, aggregates and cohesion have to agree on whether cohesion is approximated
+	boid_aggregate.theta = boid_aggregate_theta;
+}
+
+// slider over the most neighbours a behaviour considers, 0 considers every neighbour in range
+static void draw_nearest_slider(float* value, behaviour_t* behaviour)
+{
+	uiLabelNext("nearest", 0.25f);
+	uiSlider(value, 0.f, BOID_NEAR_COUNT, 1.f);
+	behaviour->nearest = (int)*value;
+}
+
+// runs on the render thread, sliders write into gui_params which the sim thread picks up on its next step
+void draw_gui()
 {
 	static int show_sliders = 1;
+	char locality_label[32];
+	char error_label[48];
 	
 	int ww, wh;
 	SDL_GetRendererOutputSize(renderer, &ww, &wh);
 	
-	boid_available_area.w = ww;
-	boid_available_area.h = wh;
-	boid_available_area.x = 0;
+	SDL_Rect area = {
+		0, 0, ww, wh
+	};
 	
 	SDL_Rect rect = {
 		0, 0, 500, wh
 	};
 	
+	SDL_AtomicLock(&ui_area_lock);
+	sim_stats_t stats = ui_stats;
+	SDL_AtomicUnlock(&ui_area_lock);
+	
 	uiBeginFrame();
 	
 	if(uiBeginWindow(&rect, &show_sliders))
 	{
 		// set the area boids will stay in to exclude the area of the ui
-		boid_available_area.x = rect.w;
-		boid_available_area.w = ww - rect.w;
+		area.x = rect.w;
+		area.w = ww - rect.w;
 		
 		// render velocity and acceleration sliders
 		uiLabelNext("speed", 0.25f);
-		uiSlider(&boid_max_velocity, 10.f, 100.f, 5.f);
+		uiSlider(&gui_params.max_velocity, 10.f, 100.f, 5.f);
 		uiLabelNext("acceleration", 0.25f);
-		uiSlider(&boid_acceleration, 10.f, 100.f, 5.f);
+		uiSlider(&gui_params.acceleration, 10.f, 100.f, 5.f);
 		
 		// alignment parameters
 		uiHeader("alignment");
 		
 		uiLabelNext("range", 0.25f);
-		uiSlider(&(alignment.range), 0.1f, 100.f, 1.f);
+		uiSlider(&(gui_params.alignment.range), 0.1f, 100.f, 1.f);
 		uiLabelNext("force", 0.25f);
-		uiSlider(&(alignment.force), 0.0f, 2.f, 0.01f);
+		uiSlider(&(gui_params.alignment.force), 0.0f, 2.f, 0.01f);
+		draw_nearest_slider(&gui_nearest[BOID_NEAR_ALIGNMENT], &gui_params.alignment);
 		
 		// cohesion parameters
 		uiHeader("cohesion");
 		
 		uiLabelNext("range", 0.25f);
-		uiSlider(&(cohesion.range), 0.1f, 100.f, 1.f);
+		uiSlider(&(gui_params.cohesion.range), 0.1f, 100.f, 1.f);
 		uiLabelNext("force", 0.25f);
-		uiSlider(&(cohesion.force), 0.0f, 2.f, .01f);
+		uiSlider(&(gui_params.cohesion.force), 0.0f, 2.f, .01f);
+		draw_nearest_slider(&gui_nearest[BOID_NEAR_COHESION], &gui_params.cohesion);
+		// 0 is exact, larger values merge more distant cells of boids
+		uiLabelNext("approx", 0.25f);
+		uiSlider(&gui_params.aggregate_theta, 0.f, 1.f, .05f);
+		if(gui_params.aggregate_theta > 0.f)
+		{
+			snprintf(error_label, sizeof(error_label), "error %.2f%%, max %.2f%%",
+					 stats.aggregate_mean_error * 100.f, stats.aggregate_max_error * 100.f);
+			uiLabel(error_label);
+		}
 		
 		// mouse interaction parameters
 		uiHeader("mouse");
 		
 		uiLabelNext("range", 0.25f);
-		uiSlider(&(mouse_interact.range), 0.1f, 100.f, 1.f);
+		uiSlider(&(gui_params.mouse_interact.range), 0.1f, 100.f, 1.f);
 		uiLabelNext("force", 0.25f);
-		uiSlider(&(mouse_interact.force), -200.f, 200.f, 10.f);
+		uiSlider(&(gui_params.mouse_interact.force), -200.f, 200.f, 10.f);
 		
 		
 		// separation range
 		uiHeader("separation");
 
-		uiSlider(&(separation.range), 0.1f, 100.f, 1.f);
+		uiSlider(&(gui_params.separation.range), 0.1f, 100.f, 1.f);
+		draw_nearest_slider(&gui_nearest[BOID_NEAR_SEPARATION], &gui_params.separation);
+		
+		// margin added to neighbour lists so they can be reused across frames
+		uiHeader("neighbours");
+		
+		uiLabelNext("skin", 0.25f);
+		uiSlider(&gui_params.near_skin, 0.f, 20.f, 1.f);
+		
+		// storage locality gained by the last z-order sort
+		snprintf(locality_label, sizeof(locality_label), "locality gain %.1fx", stats.sort_gain);
+		uiLabel(locality_label);
+	}
+	
+	uiEndFrame();
+	
+	SDL_AtomicLock(&ui_area_lock);
+	ui_area = area;
+	ui_params = gui_params;
+	SDL_AtomicUnlock(&ui_area_lock);
+}
+
+void sim_render()
+{
+	boid_snapshot_t* snapshot = triple_buffer_acquire(&boid_snapshots, NULL);
+	
+	draw_boids(snapshot);
+	draw_obstacles(snapshot->obstacles, snapshot->obstacle_count);
+	draw_gui();
+}
+
+// writes every boid_raster_interval-th snapshot to a numbered image
+void sim_render_headless()
+{
+	static int frame = 0;
+	char path[256];
+	short fresh;
+	boid_snapshot_t* snapshot = triple_buffer_acquire(&boid_snapshots, &fresh);
+	
+	if(!fresh || boid_raster_interval <= 0 || snapshot->step % (size_t)boid_raster_interval != 0)
+		return;
+	
+	boid_raster_draw(snapshot);
+	if(snprintf(path, sizeof(path), boid_raster_path, frame) >= (int)sizeof(path))
+	{
+		SDL_Log("Raster path for frame %d is longer than %zu characters, stopping", frame, sizeof(path) - 1);
+		SDL_PushEvent(&(SDL_Event){ .type = SDL_QUIT });
+		return;
+	}
+	++frame;
+	
+	// the images are all a headless run produces, carrying on without them would only hide the failure
+	if(boid_raster_write(path) != 0)
+	{
+		SDL_Log("Stopping after failing to write frame %d at step %zu", frame - 1, snapshot->step);
+		SDL_PushEvent(&(SDL_Event){ .type = SDL_QUIT });
+	}
+}
+
+// true when pattern holds exactly one int conversion such as %d or %06d and no other conversion
+static short raster_pattern_valid(const char* pattern)
+{
+	int conversions = 0;
+	
+	for(const char* c = pattern; *c != '\0'; ++c)
+	{
+		if(*c != '%') continue;
+		if(*++c == '%') continue;
+		
+		while(*c == '0' || *c == '-' || *c == '+' || *c == ' ') ++c;
+		while(*c >= '0' && *c <= '9') ++c;
+		if(*c != 'd' && *c != 'i') return 0;
+		++conversions;
 	}
+	return conversions == 1;
 }
 
 void sim_config(engine_init_t* config)
@@ -77,27 +268,100 @@ void sim_config(engine_init_t* config)
 	config->window_init_flags |= SDL_WINDOW_RESIZABLE;
 	boid_spawn_num = 500;
 	config->target_framerate = 24;
+	
+	// split the arena across processes when started as part of a distributed run
+	const char* rank = getenv("BOIDS_DOMAIN_RANK");
+	const char* count = getenv("BOIDS_DOMAIN_COUNT");
+	const char* socket_dir = getenv("BOIDS_DOMAIN_DIR");
+	domain_rank = rank != NULL ? atoi(rank) : 0;
+	domain_count = count != NULL ? atoi(count) : 1;
+	domain_socket_dir = socket_dir != NULL ? socket_dir : "/tmp";
+	domain_world = (SDL_Rect){ 0, 0, config->window_width, config->window_height };
+	
+	// publish boid state to shared memory for external tools
+	const char* capacity = getenv("BOIDS_PUBLISH_CAPACITY");
+	publish_name = getenv("BOIDS_PUBLISH");
+	publish_capacity = capacity != NULL ? (uint32_t)atoi(capacity) : 65536;
+	
+	// cap alignment, cohesion and separation at the BOIDS_NEAREST nearest neighbours for a fixed cost per boid
+	const char* nearest = getenv("BOIDS_NEAREST");
+	if(nearest != NULL)
+	{
+		// 0 keeps every neighbour in range, lists never hold more than BOID_NEAR_COUNT
+		int k = atoi(nearest);
+		k = k < 0 ? 0 : k > BOID_NEAR_COUNT ? BOID_NEAR_COUNT : k;
+		alignment.nearest = cohesion.nearest = separation.nearest = k;
+	}
+	
+	// wrap boids around the edges of the arena with BOIDS_PERIODIC=1, strips of a distributed run have real walls
+	const char* periodic = getenv("BOIDS_PERIODIC");
+	boid_periodic = periodic != NULL && atoi(periodic) != 0 && domain_count <= 1;
+	
+	// count cycles, instructions and misses of systems with BOIDS_PERF_COUNTERS=1
+	const char* counters = getenv("BOIDS_PERF_COUNTERS");
+	config->hw_counters = counters != NULL && atoi(counters) != 0;
+	
+	// record the window with BOIDS_CAPTURE=run.y4m
+	config->capture_path = getenv("BOIDS_CAPTURE");
+	
+	// BOIDS_HEADLESS=1 runs without a window, drawing every BOIDS_RASTER_INTERVAL-th step to BOIDS_RASTER_PATH,
+	// for BOIDS_STEPS steps or until interrupted
+	const char* headless = getenv("BOIDS_HEADLESS");
+	const char* raster_path = getenv("BOIDS_RASTER_PATH");
+	const char* raster_interval = getenv("BOIDS_RASTER_INTERVAL");
+	const char* steps = getenv("BOIDS_STEPS");
+	config->headless = headless != NULL && atoi(headless) != 0;
+	// the pattern is used as a format string, anything but a single frame number would read arguments that are not there
+	if(raster_path != NULL && raster_pattern_valid(raster_path)) boid_raster_path = raster_path;
+	else if(raster_path != NULL) SDL_Log("BOIDS_RASTER_PATH needs exactly one %%d for the frame number, using %s", boid_raster_path);
+	if(raster_interval != NULL) boid_raster_interval = atoi(raster_interval);
+	config->max_steps = steps != NULL ? strtoull(steps, NULL, 10) : 0;
+	
+	// BOIDS_SIMRATE paces steps, headless runs are unpaced unless it is set
+	// and advance by the same sim time every step so their frames do not depend on the machine
+	const char* simrate = getenv("BOIDS_SIMRATE");
+	if(simrate != NULL)
+		config->target_simrate = atoi(simrate);
+	else if(config->headless)
+		config->target_simrate = 0;
+	if(config->headless)
+		config->fixed_delta_time = 1.0 / (double)(config->target_simrate > 0 ? config->target_simrate : 120);
+	
+	// large per-boid buffers go on huge pages unless turned off
+	const char* huge_pages = getenv("BOIDS_HUGE_PAGES");
+	arena_flags = ARENA_PREFAULT;
+	if(huge_pages == NULL || atoi(huge_pages) != 0)
+		arena_flags |= ARENA_HUGE_PAGES;
 }
 
 void spawn_boids()
 {
-	int w, h;
-	SDL_GetRendererOutputSize(renderer, &w, &h);
+	int w = boid_available_area.x + boid_available_area.w, h = boid_available_area.h;
 	
 	fvec position = {9, 0};
 	ecsEntityId entity;
 	boid_c* boid;
 	
-	for(int i = 0; i < boid_spawn_num; i++)
+	// only spawn into the strip this process owns
+	float min_x, max_x;
+	int x = boid_available_area.x, spawn_num = boid_spawn_num / boid_domain_count;
+	boid_domain_strip(boid_domain_rank, &min_x, &max_x);
+	if(min_x > x) x = min_x;
+	if(max_x < w) w = max_x;
+	w -= x;
+	
+	for(int i = 0; i < spawn_num; i++)
 	{
-		position = (fvec){rand() % w, rand() % h};
+		position = (fvec){x + rand() % w, boid_available_area.y + rand() % h};
 		if((entity = ecsCreateEntity(boid_component)) != noentity)
 		{
 			boid = ecsGetComponentPtr(entity, boid_component);
 			(*boid) = (boid_c){
 				.position = position,
 				.velocity = {0,0},
-				.force = {0,0}
+				.force = {0,0},
+				.uid = boid_domain_make_uid(),
+				.ownership = BOID_OWNED
 			};
 		}
 		else
@@ -109,40 +373,65 @@ void spawn_boids()
 
 void sim_init()
 {
-	// register boid_c as a component type
-	boid_component = ecsRegisterComponent(boid_c);
-	
-	// enable the functions that make boids boid
-	ecsEnableSystem(&system_boid_update_position, boid_component, ECS_QUERY_ALL, 8, 50);
-	ecsEnableSystem(&system_boid_update_near, boid_component, ECS_QUERY_ALL, 0, 100);
-	ecsEnableSystem(&system_draw_boids, boid_component, ECS_QUERY_ALL, 0, 200);
-	ecsEnableSystem(&system_boids_wall_avoid, boid_component, ECS_QUERY_ALL, 8, 300);
-	ecsEnableSystem(&system_boids_cohesion, boid_component, ECS_QUERY_ALL, 8, 400);
-	ecsEnableSystem(&system_boids_alignment, boid_component, ECS_QUERY_ALL, 8, 410);
-	ecsEnableSystem(&system_boids_separation, boid_component, ECS_QUERY_ALL, 8, 420);
-	ecsEnableSystem(&system_boid_mouse, boid_component, ECS_QUERY_ALL, 8, 430);
-	
-	// enable the gui system
-	ecsEnableSystem(&system_draw_gui, nocomponent, ECS_NOQUERY, 0, 500);
+	// register boid_c and enable the functions that make boids boid
+	boid_schedule_init(arena_flags);
+	
+	// and those that connect them to the gui, the renderer and other tools
+	ecsEnableSystem(&system_apply_ui_area, nocomponent, ECS_NOQUERY, 0, 0);
+	if(publish_name != NULL && boid_publish_open(publish_name, publish_capacity, 4) == 0)
+		ecsEnableSystem(&system_boid_publish, boid_component, ECS_QUERY_ALL, 0, 60);
+	// publish what the render thread draws once positions are final for the step
+	boid_snapshot_init(arena_flags);
+	ecsEnableSystem(&system_boid_snapshot, boid_component, ECS_QUERY_ALL, 0, 70);
+	ecsEnableSystem(&system_boid_mouse, nocomponent, ECS_NOQUERY, 0, 430);
 
 	int w, h;
-	SDL_GetRendererOutputSize(renderer, &w, &h);
-	
-	// load boid image
-	//asset_handle_t blur_asset = load_asset("blur.png");
-	asset_handle_t arrow_asset = load_asset("boid.png");
-	// set boid texture
-	boid_texture = get_asset(arrow_asset);
+	engine_output_size(&w, &h);
+	if(domain_count > 1)
+	{
+		w = domain_world.w;
+		h = domain_world.h;
+	}
 	
-	// load and set font
-	asset_handle_t font_asset = load_asset("Inter-Regular.otf");
-	uiSetFont(get_asset(font_asset));
+	if(renderer != NULL)
+	{
+		// load boid image
+		//asset_handle_t blur_asset = load_asset("blur.png");
+		asset_handle_t arrow_asset = load_asset("boid.png");
+		// set boid texture
+		boid_texture = get_asset(arrow_asset);
+		
+		// load and set font
+		asset_handle_t font_asset = load_asset("Inter-Regular.otf");
+		uiSetFont(get_asset(font_asset));
+	}
+	else if(boid_raster_init(w, h) != 0)
+	{
+		// headless runs exist to produce images
+		exit(4);
+	}
 	
 	// set the initially available area
-	boid_available_area = (SDL_Rect){
+	boid_available_area = ui_area = (SDL_Rect){
 		.x = 0, .y = 0,
 		.w = w, .h = h
 	};
+	gui_params = ui_params = sim_params_current();
+	ui_stats = (sim_stats_t){ .sort_gain = boid_sort_gain };
+	gui_nearest[BOID_NEAR_ALIGNMENT] = alignment.nearest;
+	gui_nearest[BOID_NEAR_COHESION] = cohesion.nearest;
+	gui_nearest[BOID_NEAR_SEPARATION] = separation.nearest;
+	
+	// place a few obstacles for the boids to avoid
+	obstacle_add_circle((fvec){ w * 0.55f, h * 0.3f }, 60.f);
+	obstacle_add_circle((fvec){ w * 0.8f, h * 0.6f }, 90.f);
+	obstacle_add_rect((fvec){ w * 0.6f, h * 0.8f }, (fvec){ 100.f, 20.f });
+	
+	// connect to the processes owning the neighbouring strips
+	if(domain_count > 1 && boid_domain_init(domain_rank, domain_count, domain_socket_dir, &boid_available_area) != 0)
+	{
+		exit(3);
+	}
 	
 	// spawn a bunch of boids
 	spawn_boids();
@@ -150,5 +439,16 @@ void sim_init()
 
 void sim_quit()
 {
+	boid_domain_quit();
+	boid_publish_close();
+	obstacle_terminate();
+	boid_aggregate_report();
+	boid_aggregate_terminate();
+	boid_grid_terminate();
+	boid_snapshot_terminate();
+	boid_raster_terminate();
+	
+	if(boid_density_texture != NULL)
+		SDL_DestroyTexture(boid_density_texture);
 }
 